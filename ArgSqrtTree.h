@@ -0,0 +1,144 @@
+#ifndef ARG_SQRT_TREE
+#define ARG_SQRT_TREE
+#include "BasicLibraries.h"
+#include "SqrtTree.h"
+#include <cstdint>
+using namespace std;
+
+// position of the answer inside a block, the biggest block of any layer has 2^16 elements
+typedef uint16_t ArgOffset;
+
+// ArgSqrtTree's storage: a slot holds the position of the best element of its range, kept as an ArgOffset
+// from the start of its block. The values are kept once, op compares them, and the index part holds the
+// position of the best element of every child block of layer 0, so a query on it returns a position too.
+// Compare is less<SqrtTreeItem> for argmin and greater<SqrtTreeItem> for argmax, ties go to the leftmost position.
+template<typename Compare>
+class ArgOffsets {
+    public:
+        typedef int Item;
+        typedef vector<SqrtTreeItem> ValueVector;
+
+    private:
+        // n is the number of values, indexLog the child block size log of layer 0
+        int n, indexLog;
+        vector<SqrtTreeItem> values;
+        // indexBest[i] is the position of the best element of child block i of layer 0, the value of slot n + i
+        vector<int> indexBest;
+        vector<vector<ArgOffset>> prefix, suffix, between;
+        Compare cmp;
+
+        // where a position is in the part that the block at start belongs to: itself in the original array,
+        // the slot of its child block of layer 0 in the index part
+        int slotOf(int pos, int start) const {
+            return start < n ? pos : n + (pos >> indexLog);
+        }
+
+    public:
+        // the values are kept in std::vector, the allocator of the tree is not used
+        explicit ArgOffsets(const allocator<SqrtTreeItem> &) {}
+
+        explicit ArgOffsets(ValueVector &&a) : values(move(a)) {}
+
+        template<typename InputIt>
+        void assign(InputIt first, InputIt last, size_t) {
+            values.assign(first, last);
+        }
+
+        int valueCount() const {
+            return values.size();
+        }
+
+        void allocate(int n, int indexSize, const vector<int> &layers, const vector<int> &betweenSizes) {
+            this->n = n;
+            indexLog = layers.empty() ? 0 : (layers[0] + 1) >> 1;
+            indexBest.assign(indexSize, 0);
+            prefix.assign(layers.size(), vector<ArgOffset>(n + indexSize));
+            suffix.assign(layers.size(), vector<ArgOffset>(n + indexSize));
+            between.resize(betweenSizes.size());
+            for (int layer = 0; layer < (int) betweenSizes.size(); layer++) {
+                between[layer].assign(betweenSizes[layer], 0);
+            }
+        }
+
+        // the better of the positions a < b
+        int op(int a, int b) const {
+            return cmp(values[b], values[a]) ? b : a;
+        }
+
+        // the position slot i stands for
+        int leaf(int i) const {
+            return i < n ? i : indexBest[i - n];
+        }
+
+        // only the index part is set, a value keeps its position
+        void setLeaf(int i, int pos) {
+            indexBest[i - n] = pos;
+        }
+
+        void setValue(int i, const SqrtTreeItem &val) {
+            values[i] = val;
+        }
+
+        SqrtTreeItem get(int i) const {
+            return values[i];
+        }
+
+        int prefixAt(int layer, int i, int start) const {
+            return leaf(start + prefix[layer][i]);
+        }
+
+        int suffixAt(int layer, int i, int start) const {
+            return leaf(start + suffix[layer][i]);
+        }
+
+        void setPrefix(int layer, int i, int start, int pos) {
+            prefix[layer][i] = slotOf(pos, start) - start;
+        }
+
+        void setSuffix(int layer, int i, int start, int pos) {
+            suffix[layer][i] = slotOf(pos, start) - start;
+        }
+
+        void finishBlock(int, int, int) {}
+
+        // between offsets are counted from the start of the layer block
+        int betweenAt(int layer, int k, int lBound) const {
+            return leaf(lBound + between[layer - 1][k]);
+        }
+
+        void setBetween(int layer, int k, int lBound, int pos) {
+            between[layer - 1][k] = slotOf(pos, lBound) - lBound;
+        }
+
+        size_t memoryUsage() const {
+            size_t bytes = values.size() * sizeof(SqrtTreeItem) + indexBest.size() * sizeof(int);
+            for (int layer = 0; layer < (int) prefix.size(); layer++) {
+                bytes += (prefix[layer].size() + suffix[layer].size()) * sizeof(ArgOffset);
+            }
+            for (const auto &layer : between) {
+                bytes += layer.size() * sizeof(ArgOffset);
+            }
+            return bytes;
+        }
+};
+
+// SqrtTree that returns the position of the minimum (or maximum) of a range in O(1).
+// The layers are the ones of BasicSqrtTree, but prefix/suffix/between keep only where the best element
+// is, as an offset from the start of its block in 16 bits, and the values are kept once.
+// prefix/suffix offsets are counted from the start of the child block, between offsets from the
+// start of the layer block, so each slot takes 2 bytes instead of 4 for an int or 8 for (value, index).
+// query(l, r) returns the position of the best element of [l...r], the leftmost one on ties.
+template<typename Compare = less<SqrtTreeItem>>
+class ArgSqrtTree : public BasicSqrtTree<allocator<SqrtTreeItem>, int, ArgOffsets<Compare>> {
+    public:
+        using BasicSqrtTree<allocator<SqrtTreeItem>, int, ArgOffsets<Compare>>::BasicSqrtTree;
+
+        SqrtTreeItem get(int idx) const {
+            return this->store.get(idx);
+        }
+};
+
+typedef ArgSqrtTree<less<SqrtTreeItem>> ArgMinSqrtTree;
+typedef ArgSqrtTree<greater<SqrtTreeItem>> ArgMaxSqrtTree;
+
+#endif
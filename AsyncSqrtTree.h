@@ -0,0 +1,165 @@
+#ifndef ASYNC_SQRT_TREE
+#define ASYNC_SQRT_TREE
+#include "BasicLibraries.h"
+#include "SqrtTree.h"
+#include <atomic>
+#include <map>
+#include <thread>
+using namespace std;
+
+// SqrtTree whose construction returns at once: the layers are built on a background thread
+// while the queries are answered by a fallback, a prefix-sum array that the builder fills first
+// and publishes every PREFIX_CHUNK elements, with a direct scan of the part it has not reached yet.
+// The updates that arrive before the layers are done are kept in a map (latest value per index),
+// the fallback adds their difference to its answer, and they are replayed on the tree when it
+// takes over, between two calls. The fallback needs op to be a sum, like the SqrtTreeItem op here.
+// The values are moved into the tree, not copied: arr is reserved with room for the index part, so the
+// tree keeps its buffer, and the fallback goes on reading the values there (the builder only writes
+// after them). Peak memory during a build is n values, the prefix sums and the layers of the tree.
+// Not thread safe, like SqrtTree: one thread calls the tree, the builder only reads the values.
+enum AsyncBuildStage { SCAN_STAGE, PREFIX_STAGE, LAYER_STAGE };
+
+class AsyncSqrtTree {
+    private:
+        static const int PREFIX_CHUNK = 1 << 16;
+
+        int n;
+        // the values at construction, moved into the tree by the builder
+        vector<SqrtTreeItem> arr;
+        // arr.data(), still valid in the tree after the move, only this pointer is read by the fallback
+        const SqrtTreeItem *values;
+        // prefixSum[i] = arr[0] + ... + arr[i - 1], valid for i <= prefixDone
+        // (not value-initialized, so the constructor does not touch the pages)
+        unique_ptr<long long[]> prefixSum;
+        atomic<int> prefixDone{0};
+        unique_ptr<SqrtTree> tree;
+        thread builder;
+        atomic<bool> built{false};
+        bool ready = false;
+        // updates since construction, replayed on the tree
+        map<int, SqrtTreeItem> pending;
+        long long replayed = 0;
+
+        void takeOver() {
+            builder.join();
+            for (const auto &update : pending) {
+                tree->update(update.first, update.second);
+            }
+            replayed = pending.size();
+            pending.clear();
+            prefixSum.reset();
+            ready = true;
+        }
+
+        void startBuilder() {
+            // with this capacity the tree adds its index part in place, so values stays valid
+            arr.reserve(SqrtTree::storageSize(n));
+            values = arr.data();
+            prefixSum[0] = 0;
+            builder = thread([this]() {
+                for (int i = 0; i < n; i++) {
+                    prefixSum[i + 1] = prefixSum[i] + values[i];
+                    if ((i + 1) % PREFIX_CHUNK == 0) {
+                        prefixDone.store(i + 1, memory_order_release);
+                    }
+                }
+                prefixDone.store(n, memory_order_release);
+                tree.reset(new SqrtTree(move(arr)));
+                built.store(true, memory_order_release);
+            });
+        }
+
+        void checkBuilt() {
+            if (!ready && built.load(memory_order_acquire)) {
+                takeOver();
+            }
+        }
+
+    public:
+        AsyncSqrtTree(const vector<SqrtTreeItem> &a) : n(a.size()), prefixSum(new long long[a.size() + 1]) {
+            arr.reserve(SqrtTree::storageSize(n));
+            arr.assign(a.begin(), a.end());
+            startBuilder();
+        }
+
+        // Take the array instead of copying it, the constructor then only starts the builder
+        // (unless a.capacity() is below SqrtTree::storageSize(n), then it is reallocated once here)
+        AsyncSqrtTree(vector<SqrtTreeItem> &&a) : n(a.size()), arr(move(a)), prefixSum(new long long[n + 1]) {
+            startBuilder();
+        }
+
+        ~AsyncSqrtTree() {
+            if (builder.joinable()) {
+                builder.join();
+            }
+        }
+
+        AsyncSqrtTree(const AsyncSqrtTree &) = delete;
+        AsyncSqrtTree &operator=(const AsyncSqrtTree &) = delete;
+
+        SqrtTreeItem query(int l, int r) {
+            checkBuilt();
+            if (ready) {
+                return tree->query(l, r);
+            }
+            // prefix sums up to done, scan after it
+            int done = prefixDone.load(memory_order_acquire);
+            long long sum = 0;
+            if (r + 1 <= done) {
+                sum = prefixSum[r + 1] - prefixSum[l];
+            } else {
+                int from = l;
+                if (l < done) {
+                    sum = prefixSum[done] - prefixSum[l];
+                    from = done;
+                }
+                for (int i = from; i <= r; i++) {
+                    sum += values[i];
+                }
+            }
+            // the updates inside the range replace their original value
+            for (auto it = pending.lower_bound(l); it != pending.end() && it->first <= r; ++it) {
+                sum += (long long)it->second - values[it->first];
+            }
+            return (SqrtTreeItem)sum;
+        }
+
+        void update(int idx, const SqrtTreeItem &val) {
+            checkBuilt();
+            if (ready) {
+                tree->update(idx, val);
+            } else {
+                pending[idx] = val;
+            }
+        }
+
+        // Block until the layers are built and the buffered updates replayed
+        void waitUntilReady() {
+            if (!ready) {
+                takeOver();
+            }
+        }
+
+        AsyncBuildStage stage() {
+            checkBuilt();
+            if (ready) {
+                return LAYER_STAGE;
+            }
+            return prefixDone.load(memory_order_acquire) == n ? PREFIX_STAGE : SCAN_STAGE;
+        }
+
+        // updates waiting for the tree, and updates replayed on it when it took over
+        int pendingCount() const { return pending.size(); }
+        long long replayedCount() const { return replayed; }
+
+        // Bytes used now: the tree once it has taken over, the array and the fallback before
+        size_t memoryUsage() const {
+            if (ready) {
+                return tree->memoryUsage();
+            }
+            size_t prefixBytes = (size_t)(prefixDone.load(memory_order_acquire) + 1) * sizeof(long long);
+            return (size_t)n * sizeof(SqrtTreeItem) + prefixBytes + pending.size() * (sizeof(int) + sizeof(SqrtTreeItem));
+        }
+};
+
+#endif
@@ -7,5 +7,14 @@
 #include <climits>
 #include <string>
 #include <algorithm>
+#include <memory>
+#include <iterator>
+#include <type_traits>
+
+// std::span constructors of the trees, C++20 only
+#if __cplusplus >= 202002L && __has_include(<span>)
+#include <span>
+#define HAS_STD_SPAN 1
+#endif
 
 #endif
@@ -0,0 +1,335 @@
+#ifndef COMPACT_SQRT_TREE
+#define COMPACT_SQRT_TREE
+#include "BasicLibraries.h"
+#include "SqrtTree.h"
+#include <cstdint>
+#include <memory>
+#include <limits>
+using namespace std;
+
+// Groups of 1 << groupLog values of T, kept dense (group g is the g-th one) in chunks of 1 << chunkLog groups.
+// A chunk never moves, it is allocated when the first of its groups is pushed and freed when its last one
+// is popped, so a push or a pop costs O(1) besides the copy of one group and the memory follows the count.
+template<typename T>
+class GroupPool {
+    private:
+        int groupLog = 0, chunkLog = 0, count = 0;
+        vector<unique_ptr<T[]>> chunks;
+
+    public:
+        void init(int groupLog, int chunkLog) {
+            this->groupLog = groupLog;
+            this->chunkLog = chunkLog;
+            count = 0;
+            chunks.clear();
+        }
+
+        T *at(int g) const {
+            return chunks[g >> chunkLog].get() + ((size_t)(g & ((1 << chunkLog) - 1)) << groupLog);
+        }
+
+        int size() const {
+            return count;
+        }
+
+        // add a group at the end (not initialized), returns its number
+        int push() {
+            if ((count >> chunkLog) == (int) chunks.size()) {
+                chunks.emplace_back(new T[(size_t)1 << (groupLog + chunkLog)]);
+            }
+            return count++;
+        }
+
+        // remove the last group
+        void pop() {
+            count--;
+            if ((count & ((1 << chunkLog) - 1)) == 0) {
+                chunks.pop_back();
+            }
+        }
+
+        size_t memoryUsage() const {
+            return chunks.size() * (sizeof(unique_ptr<T[]>) + (sizeof(T) << (groupLog + chunkLog)));
+        }
+};
+
+// CompactSqrtTree's storage: the prefix/suffix values of the original array are narrow Delta integers.
+// Inside a child block every prefix and suffix value lies between the smallest and the biggest partial sum
+// of the block, so each child block keeps that smallest value once as its base and every slot keeps only
+// value - base in a Delta (uint16_t by default, 2 bytes instead of 4); queries add the base back.
+// A layer is compacted only if childBlockSize * (value range of the array, with 0) fits in Delta, so all its
+// blocks fit at build, and if its blocks are big enough for the deltas to take less room than plain slots;
+// the other layers keep plain SqrtTreeItem slots like SqrtTree and cost nothing extra.
+// On a compacted layer every child block owns one group of 2 * childBlockSize slots (prefix then suffix),
+// either in the Delta pool or, once an update makes it too wide for Delta, in the full width pool; it moves
+// back to the Delta pool when an update makes it fit again. Both pools stay dense (the last group fills the
+// hole of a removed one), so a widened block leaves no Delta slots behind and moving a block costs
+// O(child block size). The answers are always exact.
+// Only the original array [0...n-1] is compacted: the index part holds sums of whole blocks of layer 0, it is
+// small and kept full width, like the between arrays.
+template<typename Delta>
+class DeltaStorage {
+    public:
+        typedef SqrtTreeItem Item;
+        typedef vector<SqrtTreeItem> ValueVector;
+
+    private:
+        // group >= 0: group of the Delta pool, base is the smallest value of the block
+        // group < 0: group ~group of the full width pool, base is not used
+        struct BlockSlots {
+            SqrtTreeItem base;
+            int group;
+        };
+
+        // the slots of one layer, kept together so that a read finds them from one place
+        struct LayerSlots {
+            // childBlockSizeLog of the layer
+            int childLog;
+            // slots i >= plainStart are plain: prefix[i - plainStart], 0 for a layer that is not compacted,
+            // n when only the index part is plain
+            int plainStart;
+            vector<SqrtTreeItem> prefix, suffix;
+            // the child blocks of a compacted layer, and the block that owns each group of the pools
+            vector<BlockSlots> blocks;
+            GroupPool<Delta> deltas;
+            GroupPool<SqrtTreeItem> wide;
+            vector<int> deltaOwner, wideOwner;
+        };
+
+        int n;
+        vector<SqrtTreeItem> arr;
+        vector<vector<SqrtTreeItem>> between;
+        vector<LayerSlots> slots;
+        // prefix/suffix of the block being built
+        vector<SqrtTreeItem> blockPrefix, blockSuffix;
+
+        // remove group g of a pool by moving its last group into it
+        template<typename T>
+        static void removeGroup(LayerSlots &s, GroupPool<T> &pool, vector<int> &owner, int g, bool wide) {
+            int last = pool.size() - 1;
+            if (g != last) {
+                copy(pool.at(last), pool.at(last) + (2 << s.childLog), pool.at(g));
+                owner[g] = owner[last];
+                s.blocks[owner[g]].group = wide ? ~g : g;
+            }
+            pool.pop();
+            owner.pop_back();
+        }
+
+    public:
+        // the slots are kept in std::vector, the allocator of the tree is not used
+        explicit DeltaStorage(const allocator<SqrtTreeItem> &) {}
+
+        explicit DeltaStorage(ValueVector &&a) : arr(move(a)) {}
+
+        template<typename InputIt>
+        void assign(InputIt first, InputIt last, size_t capacity) {
+            arr.reserve(capacity);
+            arr.assign(first, last);
+        }
+
+        int valueCount() const {
+            return arr.size();
+        }
+
+        void allocate(int n, int indexSize, const vector<int> &layers, const vector<int> &betweenSizes) {
+            this->n = n;
+            // every prefix/suffix value of a child block lies in [childBlockSize * low, childBlockSize * high]
+            long long low = 0, high = 0;
+            for (int i = 0; i < n; i++) {
+                low = min(low, (long long)arr[i]);
+                high = max(high, (long long)arr[i]);
+            }
+            arr.resize(n + indexSize);
+            slots.clear();
+            slots.resize(layers.size());
+            for (int layer = 0; layer < (int) layers.size(); layer++) {
+                LayerSlots &s = slots[layer];
+                s.childLog = (layers[layer] + 1) >> 1;
+                // and a compacted block also costs its BlockSlots and its owner entry, tiny blocks are cheaper plain
+                bool fits = ((high - low) << s.childLog) <= (long long)numeric_limits<Delta>::max();
+                bool smaller = (2 << s.childLog) * sizeof(Delta) + sizeof(BlockSlots) + sizeof(int) < (2 << s.childLog) * sizeof(SqrtTreeItem);
+                bool compact = fits && smaller;
+                s.plainStart = compact ? n : 0;
+                // layer 0 never covers the index part
+                int plainSize = layer > 0 ? n + indexSize - s.plainStart : n - s.plainStart;
+                s.prefix.assign(plainSize, 0);
+                s.suffix.assign(plainSize, 0);
+                if (compact) {
+                    int blocks = (n + (1 << s.childLog) - 1) >> s.childLog;
+                    // chunks of about 64 KB of deltas, not more than the layer needs
+                    int chunkLog = max(0, min(16 - s.childLog - 1 - (int) log2Up(sizeof(Delta)), (int) log2Up(blocks)));
+                    s.deltas.init(s.childLog + 1, chunkLog);
+                    // blocks are only widened by updates, each wide group is allocated on its own
+                    s.wide.init(s.childLog + 1, 0);
+                    s.blocks.resize(blocks);
+                    s.deltaOwner.reserve(blocks);
+                    for (int b = 0; b < blocks; b++) {
+                        s.blocks[b] = { 0, s.deltas.push() };
+                        s.deltaOwner.push_back(b);
+                    }
+                }
+            }
+            // the child blocks of layer 0 are the biggest ones
+            blockPrefix.assign(layers.empty() ? 0 : 1 << slots[0].childLog, 0);
+            blockSuffix.assign(blockPrefix.size(), 0);
+            between.resize(betweenSizes.size());
+            for (int layer = 0; layer < (int) betweenSizes.size(); layer++) {
+                between[layer].assign(betweenSizes[layer], 0);
+            }
+        }
+
+        SqrtTreeItem op(const SqrtTreeItem &a, const SqrtTreeItem &b) const {
+            return ::op(a, b);
+        }
+
+        SqrtTreeItem leaf(int i) const {
+            return arr[i];
+        }
+
+        void setLeaf(int i, const SqrtTreeItem &item) {
+            arr[i] = item;
+        }
+
+        void setValue(int i, const SqrtTreeItem &val) {
+            arr[i] = val;
+        }
+
+        SqrtTreeItem prefixAt(int layer, int i, int start) const {
+            const LayerSlots &s = slots[layer];
+            if (i >= s.plainStart) {
+                return s.prefix[i - s.plainStart];
+            }
+            const BlockSlots &block = s.blocks[start >> s.childLog];
+            if (block.group >= 0) {
+                return block.base + s.deltas.at(block.group)[i - start];
+            }
+            return s.wide.at(~block.group)[i - start];
+        }
+
+        SqrtTreeItem suffixAt(int layer, int i, int start) const {
+            const LayerSlots &s = slots[layer];
+            if (i >= s.plainStart) {
+                return s.suffix[i - s.plainStart];
+            }
+            const BlockSlots &block = s.blocks[start >> s.childLog];
+            int at = (1 << s.childLog) + (i - start);
+            if (block.group >= 0) {
+                return block.base + s.deltas.at(block.group)[at];
+            }
+            return s.wide.at(~block.group)[at];
+        }
+
+        // the slots of a compacted block are collected first, its base is known once they are all set
+        void setPrefix(int layer, int i, int start, const SqrtTreeItem &item) {
+            LayerSlots &s = slots[layer];
+            if (i >= s.plainStart) {
+                s.prefix[i - s.plainStart] = item;
+            } else {
+                blockPrefix[i - start] = item;
+            }
+        }
+
+        void setSuffix(int layer, int i, int start, const SqrtTreeItem &item) {
+            LayerSlots &s = slots[layer];
+            if (i >= s.plainStart) {
+                s.suffix[i - s.plainStart] = item;
+            } else {
+                blockSuffix[i - start] = item;
+            }
+        }
+
+        void finishBlock(int layer, int l, int r) {
+            LayerSlots &s = slots[layer];
+            if (l >= s.plainStart) {
+                return;
+            }
+            int len = r - l, childBlockSize = 1 << s.childLog;
+            int b = l >> s.childLog;
+            SqrtTreeItem low = blockPrefix[0], high = blockPrefix[0];
+            for (int i = 0; i < len; i++) {
+                low = min({ low, blockPrefix[i], blockSuffix[i] });
+                high = max({ high, blockPrefix[i], blockSuffix[i] });
+            }
+            bool fits = (long long)high - low <= (long long)numeric_limits<Delta>::max();
+            // move the block to the pool it belongs to now
+            if (fits && s.blocks[b].group < 0) {
+                removeGroup(s, s.wide, s.wideOwner, ~s.blocks[b].group, true);
+                s.blocks[b].group = s.deltas.push();
+                s.deltaOwner.push_back(b);
+            } else if (!fits && s.blocks[b].group >= 0) {
+                removeGroup(s, s.deltas, s.deltaOwner, s.blocks[b].group, false);
+                s.blocks[b].group = ~s.wide.push();
+                s.wideOwner.push_back(b);
+            }
+            if (fits) {
+                s.blocks[b].base = low;
+                Delta *slot = s.deltas.at(s.blocks[b].group);
+                for (int i = 0; i < len; i++) {
+                    slot[i] = (Delta)(blockPrefix[i] - low);
+                    slot[childBlockSize + i] = (Delta)(blockSuffix[i] - low);
+                }
+            } else {
+                SqrtTreeItem *slot = s.wide.at(~s.blocks[b].group);
+                copy(blockPrefix.begin(), blockPrefix.begin() + len, slot);
+                copy(blockSuffix.begin(), blockSuffix.begin() + len, slot + childBlockSize);
+            }
+        }
+
+        SqrtTreeItem betweenAt(int layer, int k, int) const {
+            return between[layer - 1][k];
+        }
+
+        void setBetween(int layer, int k, int, const SqrtTreeItem &item) {
+            between[layer - 1][k] = item;
+        }
+
+        // child blocks of the original array on all the layers
+        int blockCount() const {
+            int count = 0;
+            for (const LayerSlots &s : slots) {
+                count += (n + (1 << s.childLog) - 1) >> s.childLog;
+            }
+            return count;
+        }
+
+        int compactBlockCount() const {
+            int count = 0;
+            for (const LayerSlots &s : slots) {
+                count += s.deltas.size();
+            }
+            return count;
+        }
+
+        size_t memoryUsage() const {
+            size_t bytes = slots.size() * sizeof(LayerSlots) + (arr.size() + blockPrefix.size() + blockSuffix.size()) * sizeof(SqrtTreeItem);
+            for (const LayerSlots &s : slots) {
+                bytes += (s.prefix.size() + s.suffix.size()) * sizeof(SqrtTreeItem) + s.blocks.size() * sizeof(BlockSlots);
+                bytes += s.deltas.memoryUsage() + s.wide.memoryUsage() + (s.deltaOwner.capacity() + s.wideOwner.capacity()) * sizeof(int);
+            }
+            for (const auto &layer : between) {
+                bytes += layer.size() * sizeof(SqrtTreeItem);
+            }
+            return bytes;
+        }
+};
+
+// SqrtTree (sum) that stores the prefix/suffix values of its layers as narrow Delta integers, see DeltaStorage.
+// The deep layers, with small child blocks, are the ones that fit, e.g. blocks of 64 values up to 1000;
+// with values too big for any layer it has the layout (and the memory) of SqrtTree.
+template<typename Delta = uint16_t>
+class CompactSqrtTree : public BasicSqrtTree<allocator<SqrtTreeItem>, int, DeltaStorage<Delta>> {
+    public:
+        using BasicSqrtTree<allocator<SqrtTreeItem>, int, DeltaStorage<Delta>>::BasicSqrtTree;
+
+        // number of child blocks still stored as deltas, out of blockCount()
+        int compactBlockCount() const {
+            return this->store.compactBlockCount();
+        }
+
+        int blockCount() const {
+            return this->store.blockCount();
+        }
+};
+
+#endif
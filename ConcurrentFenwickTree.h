@@ -0,0 +1,108 @@
+#ifndef CONCURRENT_FENWICK_TREE
+#define CONCURRENT_FENWICK_TREE
+#include "BasicLibraries.h"
+#include <atomic>
+#include <memory>
+using namespace std;
+
+// FenwickTree that many threads can update at the same time without a lock.
+// Every node of bit is an atomic, update walks the tree with relaxed fetch_add.
+// With stripes > 1 the tree is split into several independent sub-trees (stripes), each
+// thread always adds into its own stripe and query merges all of them. This keeps the
+// hot top nodes (bit[2^k]) of different threads on different cache lines.
+//
+// Query semantics: every node is read atomically, so a query never sees a torn value.
+// An update that happened-before the query (e.g. its thread was joined, or it was
+// published through a release/acquire pair) is always fully counted. An update that runs
+// concurrently with the query is counted fully, partially or not at all, so the result is
+// the sum of some interleaving of the in-flight increments; once the writers are quiescent
+// every query is exact.
+class ConcurrentFenwickTree {
+private:
+	// ints per cache line, each stripe starts on its own line
+	static const int LINE_INTS = 64 / sizeof(atomic<int>);
+
+	unique_ptr<atomic<int>[]> bit;
+	int size;
+	int stripes;
+	int stride; //Distance between two stripes in bit
+
+	//Stripe of the calling thread, threads are dealt round-robin over the stripes
+	int myStripe() const {
+		static atomic<int> nextThread(0);
+		static thread_local int threadId = nextThread.fetch_add(1, memory_order_relaxed);
+		return threadId % stripes;
+	}
+
+	void add(int stripe, int idx, int val) {
+		atomic<int>* tree = bit.get() + (size_t)stripe * stride;
+		idx++;
+		while (idx <= size) {
+			tree[idx].fetch_add(val, memory_order_relaxed);
+			idx += idx & -idx; //LSB
+		}
+	}
+
+public:
+	//Create tree, the input is loaded into stripe 0
+	ConcurrentFenwickTree(const vector<int>& arr, int stripes = 1) : stripes(max(1, stripes)) {
+		size = arr.size();
+		stride = (size + 1 + LINE_INTS - 1) / LINE_INTS * LINE_INTS;
+		bit.reset(new atomic<int>[(size_t)this->stripes * stride]);
+		for (size_t i = 0; i < (size_t)this->stripes * stride; i++) {
+			bit[i].store(0, memory_order_relaxed);
+		}
+
+		//Linear time build: push every node into its parent
+		for (int i = 1; i <= size; i++) {
+			bit[i].store(bit[i].load(memory_order_relaxed) + arr[i - 1], memory_order_relaxed);
+			int parent = i + (i & -i);
+			if (parent <= size) {
+				bit[parent].store(bit[parent].load(memory_order_relaxed) + bit[i].load(memory_order_relaxed), memory_order_relaxed);
+			}
+		}
+	}
+
+	//Update node: arr[idx] = arr[idx] + val, safe to call from any number of threads
+	void update(int idx, int val) {
+		add(myStripe(), idx, val);
+	}
+
+	//Update node: arr[idx] = val
+	//The read and the add are not one atomic step, concurrent writers of the same idx may race
+	void set(int idx, int val) {
+		int current = get(idx);
+		update(idx, val - current);
+	}
+
+	//Sum from arr[0] to arr[idx] over all stripes
+	int getSum(int idx) const {
+		if (idx < 0) return 0;
+
+		int sum = 0;
+		for (int s = 0; s < stripes; s++) {
+			const atomic<int>* tree = bit.get() + (size_t)s * stride;
+			for (int i = idx + 1; i > 0; i -= i & -i) {
+				sum += tree[i].load(memory_order_relaxed);
+			}
+		}
+
+		return sum;
+	}
+
+	//Sum range from left to right
+	int query(int left, int right) const {
+		return getSum(right) - getSum(left - 1);
+	}
+
+	//Get value
+	int get(int idx) const {
+		return query(idx, idx);
+	}
+
+	int stripeCount() const {
+		return stripes;
+	}
+};
+
+#endif
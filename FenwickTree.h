@@ -4,47 +4,78 @@
 #include "BasicLibraries.h"
 using namespace std;
 
-class FenwickTree {
+//Allocator is used for bit, e.g. HugePageAllocator
+//Index is the type of positions, long long for arrays with more than 2^31 - 1 elements
+//The nodes and the sums are the Allocator's value_type, long long when the sums outgrow int
+template<typename Allocator = allocator<int>, typename Index = int>
+class BasicFenwickTree {
 private:
-	vector<int> bit;
-	int size;
+	typedef typename Allocator::value_type Item;
+
+	//Node i (the tree is indexed start at 1) is stored at bit[i - 1], so the values can be used as is
+	vector<Item, Allocator> bit;
+	Index size;
+
+	//bit holds the values, turn them into the tree in O(n): every node adds itself to its parent
+	void buildInPlace() {
+		for (Index i = 1; i <= size; i++) {
+			Index parent = i + (i & -i);
+			if (parent <= size) {
+				bit[parent - 1] += bit[i - 1];
+			}
+		}
+	}
 public:
 	//Create tree
-	FenwickTree(const vector<int>& arr) {
-		size = arr.size();
-		bit.resize(size + 1, 0); //BIT is indexed start at 1
+	BasicFenwickTree(const vector<int>& arr, const Allocator& alloc = Allocator()) : BasicFenwickTree(arr.begin(), arr.end(), alloc) {}
+
+	//Take the values without copying them, the tree is built in their buffer
+	BasicFenwickTree(vector<Item, Allocator>&& arr) : bit(move(arr)) {
+		size = bit.size();
+		buildInPlace();
+	}
 
-		for (int i = 0; i < size; i++) {
-			update(i, arr[i]);
+	//Build from a range, e.g. a memory-mapped column, the values are copied once into bit
+	template<typename InputIt, typename = typename iterator_traits<InputIt>::iterator_category>
+	BasicFenwickTree(InputIt first, InputIt last, const Allocator& alloc = Allocator()) : bit(alloc) {
+		if constexpr (is_base_of<forward_iterator_tag, typename iterator_traits<InputIt>::iterator_category>::value) {
+			bit.reserve(distance(first, last));
 		}
+		bit.insert(bit.end(), first, last);
+		size = bit.size();
+		buildInPlace();
 	}
 
+#ifdef HAS_STD_SPAN
+	BasicFenwickTree(span<const int> arr, const Allocator& alloc = Allocator()) : BasicFenwickTree(arr.begin(), arr.end(), alloc) {}
+#endif
+
 	//Update node: arr[idx] = arr[idx] + val
-	void update(int idx, int val) {
+	void update(Index idx, Item val) {
 		idx++; //Trans idx start 0 to idx start at 1
 
 		//Update nodes are affected
 		while (idx <= size) {
-			bit[idx] += val;
+			bit[idx - 1] += val;
 			idx += idx & -idx; //LSB
 		}
 	}
 
 	//Update node: arr[idx] = val
-	void set(int idx, int val) {
-		int current = getSum(idx) - getSum(idx - 1);
+	void set(Index idx, Item val) {
+		Item current = getSum(idx) - getSum(idx - 1);
 		update(idx, val - current);
 	}
 
 	//Sum from arr[0] to arr[idx]
-	int getSum(int idx) {
+	Item getSum(Index idx) {
 		if (idx < 0) return 0;
 
 		idx++;
-		int sum = 0;
+		Item sum = 0;
 
 		while (idx > 0) {
-			sum += bit[idx];
+			sum += bit[idx - 1];
 			idx -= idx & -idx;
 		}
 
@@ -52,14 +83,22 @@ public:
 	}
 
 	//Sum range from left to right
-	int query(int left, int right) {
+	Item query(Index left, Index right) {
 		return getSum(right) - getSum(left - 1);
 	}
 
 	//Get value
-	int get(int idx) {
+	Item get(Index idx) {
 		return query(idx, idx);
 	}
+
+	//Bytes used by the tree
+	size_t memoryUsage() const {
+		return bit.size() * sizeof(Item);
+	}
 };
 
+typedef BasicFenwickTree<> FenwickTree;
+typedef BasicFenwickTree<allocator<long long>, long long> FenwickTree64;
+
 #endif
\ No newline at end of file
@@ -0,0 +1,163 @@
+#ifndef INTERLEAVED_EXECUTOR
+#define INTERLEAVED_EXECUTOR
+#include "BasicLibraries.h"
+#include "SqrtTree.h"
+#include "SegmentTree.h"
+using namespace std;
+
+// How to prefetch the memory of one query of a tree, in STAGES steps.
+// stage(tree, l, r, s) issues the prefetches of step s; the data of the earlier steps is in cache by then,
+// so a step may read it to find the next addresses. After the last step the tree's own query() runs on
+// cached data. Trees without a specialization have no step and are just queried one after another.
+template<typename Tree>
+struct QueryPrefetch {
+    static const int STAGES = 0;
+    static void stage(const Tree &, long long, long long, int) {}
+};
+
+// SqrtTree: the layer is found from the highest bit of l ^ r without reading the clz table,
+// so the clz entry and the suffix/between/prefix slots of the query are all prefetched in one step.
+// A layer 0 query goes on in the index region, whose slots are prefetched the same way
+template<typename Allocator, typename Index>
+struct QueryPrefetch<BasicSqrtTree<Allocator, Index>> {
+    static const int STAGES = 1;
+
+    static void prefetchQuery(const BasicSqrtTree<Allocator, Index> &tree, Index l, Index r, Index base) {
+        if (l + 1 >= r) {
+            __builtin_prefetch(&tree.store.arr[l]);
+            __builtin_prefetch(&tree.store.arr[r]);
+            return;
+        }
+        if (!tree.clz.empty()) {
+            __builtin_prefetch(&tree.clz[(l - base) ^ (r - base)]);
+        }
+        int layer = tree.onLayer[64 - __builtin_clzll((unsigned long long)((l - base) ^ (r - base)))];
+        int childBlockSizeLog = (tree.layers[layer] + 1) >> 1;
+        Index lBound = (((l - base) >> tree.layers[layer]) << tree.layers[layer]) + base;
+        Index lBlock = ((l - lBound) >> childBlockSizeLog) + 1;
+        Index rBlock = ((r - lBound) >> childBlockSizeLog) - 1;
+        __builtin_prefetch(&tree.store.suffix[layer][l]);
+        __builtin_prefetch(&tree.store.prefix[layer][r]);
+        if (lBlock <= rBlock) {
+            if (layer == 0) {
+                prefetchQuery(tree, tree.n + lBlock, tree.n + rBlock, tree.n);
+            } else {
+                __builtin_prefetch(&tree.store.between[layer - 1][tree.betweenIndex(layer, base, lBound, lBlock, rBlock)]);
+            }
+        }
+    }
+
+    static void stage(const BasicSqrtTree<Allocator, Index> &tree, Index l, Index r, int) {
+        prefetchQuery(tree, l, r, 0);
+    }
+};
+
+// SegmentTree: the nodes on the root-to-leaf paths of l and r, found by arithmetic only
+template<typename Allocator, typename Index>
+struct QueryPrefetch<BasicSegmentTree<Allocator, Index>> {
+    static const int STAGES = 1;
+
+    static void prefetchPath(const BasicSegmentTree<Allocator, Index> &tree, Index pos) {
+        Index node = 0, start = 0, end = tree.n - 1;
+        while (start != end) {
+            __builtin_prefetch(&tree.tree[node]);
+            __builtin_prefetch(&tree.lazy[node]);
+            Index mid = start + (end - start) / 2;
+            if (pos <= mid) {
+                node = 2 * node + 1;
+                end = mid;
+            } else {
+                node = 2 * node + 2;
+                start = mid + 1;
+            }
+        }
+        __builtin_prefetch(&tree.tree[node]);
+        __builtin_prefetch(&tree.lazy[node]);
+    }
+
+    static void stage(const BasicSegmentTree<Allocator, Index> &tree, Index l, Index r, int) {
+        if (l < 0 || r >= tree.n || l > r) {
+            return;
+        }
+        prefetchPath(tree, l);
+        prefetchPath(tree, r);
+    }
+};
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#include <coroutine>
+#include <utility>
+#define HAS_INTERLEAVED_EXECUTOR 1
+
+// Coroutine that starts suspended and is resumed by the executor
+class QueryTask {
+    public:
+        struct promise_type {
+            QueryTask get_return_object() {
+                return QueryTask(coroutine_handle<promise_type>::from_promise(*this));
+            }
+            suspend_always initial_suspend() noexcept { return {}; }
+            suspend_always final_suspend() noexcept { return {}; }
+            void return_void() {}
+            void unhandled_exception() { terminate(); }
+        };
+
+        explicit QueryTask(coroutine_handle<promise_type> handle) : handle(handle) {}
+        QueryTask(QueryTask &&other) noexcept : handle(exchange(other.handle, nullptr)) {}
+        QueryTask(const QueryTask &) = delete;
+        ~QueryTask() {
+            if (handle) {
+                handle.destroy();
+            }
+        }
+
+        bool done() const { return handle.done(); }
+        void resume() { handle.resume(); }
+
+    private:
+        coroutine_handle<promise_type> handle;
+};
+
+// One lane of the executor: takes the next query, prefetches stage by stage and suspends after each
+// stage so the other lanes can issue their prefetches, then answers the query on cached data
+template<typename Tree, typename Answer>
+QueryTask interleavedLane(Tree &tree, const vector<pair<int, int>> &ranges, vector<Answer> &answers, size_t &next) {
+    while (next < ranges.size()) {
+        size_t i = next++;
+        int l = ranges[i].first, r = ranges[i].second;
+        for (int step = 0; step < QueryPrefetch<Tree>::STAGES; step++) {
+            QueryPrefetch<Tree>::stage(tree, l, r, step);
+            co_await suspend_always{};
+        }
+        answers[i] = tree.query(l, r);
+    }
+}
+
+// Answer all ranges with width queries in flight: the lanes are resumed round-robin, so while one lane
+// waits for its prefetches the others issue theirs and up to width cache misses overlap.
+// The tree is not modified, the answers are the ones tree.query(l, r) gives.
+template<typename Tree, typename Answer>
+void runInterleaved(Tree &tree, const vector<pair<int, int>> &ranges, vector<Answer> &answers, int width) {
+    answers.resize(ranges.size());
+    size_t next = 0;
+    vector<QueryTask> lanes;
+    lanes.reserve(width);
+    for (int w = 0; w < width; w++) {
+        lanes.push_back(interleavedLane(tree, ranges, answers, next));
+    }
+    int alive = width;
+    while (alive > 0) {
+        for (QueryTask &lane : lanes) {
+            if (!lane.done()) {
+                lane.resume();
+                if (lane.done()) {
+                    alive--;
+                }
+            }
+        }
+    }
+}
+
+#endif // __cpp_impl_coroutine
+
+#endif
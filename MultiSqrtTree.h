@@ -0,0 +1,149 @@
+#ifndef MULTI_SQRT_TREE
+#define MULTI_SQRT_TREE
+#include "BasicLibraries.h"
+#include "SqrtTree.h"
+using namespace std;
+
+// the aggregates a MultiSqrtTree keeps for every slot
+struct SumMinMax {
+    SqrtTreeItem sum, min, max;
+};
+
+SumMinMax combine(const SumMinMax &a, const SumMinMax &b) {
+    return { a.sum + b.sum, std::min(a.min, b.min), std::max(a.max, b.max) };
+}
+
+// how the aggregates of the slots are laid out in memory
+enum AggregateLayout {
+    AOS_LAYOUT = 0, // one SumMinMax per slot, a query reads one cache line per slot
+    SOA_LAYOUT = 1 // one array per aggregate, each aggregate is packed densely
+};
+
+template<AggregateLayout Layout>
+class AggregateArray;
+
+template<>
+class AggregateArray<AOS_LAYOUT> {
+    private:
+        vector<SumMinMax> data;
+    public:
+        void assign(int size) { data.assign(size, { 0, 0, 0 }); }
+        void resize(int size) { data.resize(size, { 0, 0, 0 }); }
+        SumMinMax get(int i) const { return data[i]; }
+        void set(int i, const SumMinMax &v) { data[i] = v; }
+        size_t size() const { return data.size(); }
+        size_t memoryUsage() const { return data.size() * sizeof(SumMinMax); }
+};
+
+template<>
+class AggregateArray<SOA_LAYOUT> {
+    private:
+        vector<SqrtTreeItem> sum, mn, mx;
+    public:
+        void assign(int size) {
+            sum.assign(size, 0);
+            mn.assign(size, 0);
+            mx.assign(size, 0);
+        }
+        void resize(int size) {
+            sum.resize(size, 0);
+            mn.resize(size, 0);
+            mx.resize(size, 0);
+        }
+        SumMinMax get(int i) const { return { sum[i], mn[i], mx[i] }; }
+        void set(int i, const SumMinMax &v) {
+            sum[i] = v.sum;
+            mn[i] = v.min;
+            mx[i] = v.max;
+        }
+        size_t size() const { return sum.size(); }
+        size_t memoryUsage() const { return 3 * sum.size() * sizeof(SqrtTreeItem); }
+};
+
+// MultiSqrtTree's storage: every slot of arr/prefix/suffix/between holds a SumMinMax, laid out as Layout
+template<AggregateLayout Layout>
+class AggregateStorage {
+    public:
+        typedef SumMinMax Item;
+        typedef vector<SqrtTreeItem> ValueVector;
+
+    private:
+        AggregateArray<Layout> arr;
+        vector<AggregateArray<Layout>> prefix, suffix, between;
+
+    public:
+        // the aggregates are kept in std::vector, the allocator of the tree is not used
+        explicit AggregateStorage(const allocator<SqrtTreeItem> &) {}
+
+        explicit AggregateStorage(ValueVector &&a) {
+            assign(a.begin(), a.end(), 0);
+        }
+
+        template<typename InputIt>
+        void assign(InputIt first, InputIt last, size_t) {
+            // a single pass input iterator can not be counted before it is read, it goes through a vector once
+            if constexpr (!is_base_of<forward_iterator_tag, typename iterator_traits<InputIt>::iterator_category>::value) {
+                ValueVector values(first, last);
+                assign(values.begin(), values.end(), 0);
+            } else {
+                arr.assign(distance(first, last));
+                for (int i = 0; first != last; ++first, i++) {
+                    setValue(i, *first);
+                }
+            }
+        }
+
+        int valueCount() const {
+            return arr.size();
+        }
+
+        void allocate(int n, int indexSize, const vector<int> &layers, const vector<int> &betweenSizes) {
+            arr.resize(n + indexSize);
+            prefix.resize(layers.size());
+            suffix.resize(layers.size());
+            for (int layer = 0; layer < (int) layers.size(); layer++) {
+                prefix[layer].assign(n + indexSize);
+                suffix[layer].assign(n + indexSize);
+            }
+            between.resize(betweenSizes.size());
+            for (int layer = 0; layer < (int) betweenSizes.size(); layer++) {
+                between[layer].assign(betweenSizes[layer]);
+            }
+        }
+
+        SumMinMax op(const SumMinMax &a, const SumMinMax &b) const {
+            return combine(a, b);
+        }
+
+        SumMinMax leaf(int i) const { return arr.get(i); }
+        void setLeaf(int i, const SumMinMax &v) { arr.set(i, v); }
+        void setValue(int i, const SqrtTreeItem &val) { arr.set(i, { val, val, val }); }
+        SumMinMax prefixAt(int layer, int i, int) const { return prefix[layer].get(i); }
+        SumMinMax suffixAt(int layer, int i, int) const { return suffix[layer].get(i); }
+        void setPrefix(int layer, int i, int, const SumMinMax &v) { prefix[layer].set(i, v); }
+        void setSuffix(int layer, int i, int, const SumMinMax &v) { suffix[layer].set(i, v); }
+        void finishBlock(int, int, int) {}
+        SumMinMax betweenAt(int layer, int k, int) const { return between[layer - 1].get(k); }
+        void setBetween(int layer, int k, int, const SumMinMax &v) { between[layer - 1].set(k, v); }
+
+        size_t memoryUsage() const {
+            size_t bytes = arr.memoryUsage();
+            for (int layer = 0; layer < (int) prefix.size(); layer++) {
+                bytes += prefix[layer].memoryUsage() + suffix[layer].memoryUsage();
+            }
+            for (const auto &layer : between) {
+                bytes += layer.memoryUsage();
+            }
+            return bytes;
+        }
+};
+
+// SqrtTree that answers sum, min and max of a range in a single traversal.
+// The structure (clz, layers, onLayer, packed between triangles) is the one of BasicSqrtTree,
+// only every slot of arr/prefix/suffix/between holds a SumMinMax, so one build and one query
+// replace three trees, and a query computes the layer and the positions once for all aggregates.
+// query(l, r) returns the SumMinMax of [l...r], update(idx, val) sets one value.
+template<AggregateLayout Layout = AOS_LAYOUT>
+using MultiSqrtTree = BasicSqrtTree<allocator<SqrtTreeItem>, int, AggregateStorage<Layout>>;
+
+#endif
@@ -0,0 +1,233 @@
+#ifndef PERSISTENT_SQRT_TREE
+#define PERSISTENT_SQRT_TREE
+#include "BasicLibraries.h"
+#include "SqrtTree.h"
+#include <deque>
+#include <memory>
+#include <unordered_set>
+using namespace std;
+
+// The storage of one version of a PersistentSqrtTree.
+// Every array of the plain SqrtTree (arr, prefix, suffix, between) is split into pages of
+// childBlockSize elements (the child block size on layer 0). Copying a PagedStorage only copies
+// the tables of pointers to pages, so two copies share every page that was not touched between them;
+// a page is copied the first time it is written (copy-on-write).
+class PagedStorage {
+    public:
+        typedef SqrtTreeItem Item;
+        typedef vector<SqrtTreeItem> ValueVector;
+
+    private:
+        // copy-on-write paged array
+        class CowArray {
+            private:
+                int pageLog, pageMask;
+                vector<shared_ptr<vector<SqrtTreeItem>>> pages;
+            public:
+                CowArray() : pageLog(0), pageMask(0) {}
+
+                CowArray(int size, int pageLog) : pageLog(pageLog), pageMask((1 << pageLog) - 1) {
+                    int pageCount = (size + pageMask) >> pageLog;
+                    pages.resize(pageCount);
+                    for (int i = 0; i < pageCount; i++) {
+                        pages[i] = make_shared<vector<SqrtTreeItem>>(1 << pageLog, 0);
+                    }
+                }
+
+                const SqrtTreeItem &operator[](int i) const {
+                    return (*pages[i >> pageLog])[i & pageMask];
+                }
+
+                // writable access, the page is copied first if another version still uses it
+                SqrtTreeItem &mut(int i) {
+                    shared_ptr<vector<SqrtTreeItem>> &page = pages[i >> pageLog];
+                    if (page.use_count() > 1) {
+                        page = make_shared<vector<SqrtTreeItem>>(*page);
+                    }
+                    return (*page)[i & pageMask];
+                }
+
+                const vector<shared_ptr<vector<SqrtTreeItem>>> &getPages() const {
+                    return pages;
+                }
+        };
+
+        // the input values, until allocate pages them
+        ValueVector values;
+        CowArray arr;
+        vector<CowArray> prefix, suffix, between;
+
+    public:
+        // the pages are kept in std::vector, the allocator of the tree is not used
+        explicit PagedStorage(const allocator<SqrtTreeItem> &) {}
+
+        explicit PagedStorage(ValueVector &&a) : values(move(a)) {}
+
+        template<typename InputIt>
+        void assign(InputIt first, InputIt last, size_t) {
+            values.assign(first, last);
+        }
+
+        int valueCount() const {
+            return values.size();
+        }
+
+        void allocate(int n, int indexSize, const vector<int> &layers, const vector<int> &betweenSizes) {
+            // a page is exactly one child block of layer 0, so a layer 0 rebuild touches one page
+            int pageLog = (log2Up(n) + 1) >> 1;
+            arr = CowArray(n + indexSize, pageLog);
+            prefix.assign(layers.size(), CowArray());
+            suffix.assign(layers.size(), CowArray());
+            for (int layer = 0; layer < (int) layers.size(); layer++) {
+                prefix[layer] = CowArray(n + indexSize, pageLog);
+                suffix[layer] = CowArray(n + indexSize, pageLog);
+            }
+            between.assign(betweenSizes.size(), CowArray());
+            for (int layer = 0; layer < (int) betweenSizes.size(); layer++) {
+                between[layer] = CowArray(betweenSizes[layer], pageLog);
+            }
+            for (int i = 0; i < n; i++) {
+                arr.mut(i) = values[i];
+            }
+            ValueVector().swap(values);
+        }
+
+        SqrtTreeItem op(const SqrtTreeItem &a, const SqrtTreeItem &b) const {
+            return ::op(a, b);
+        }
+
+        SqrtTreeItem leaf(int i) const { return arr[i]; }
+        void setLeaf(int i, const SqrtTreeItem &item) { arr.mut(i) = item; }
+        void setValue(int i, const SqrtTreeItem &val) { arr.mut(i) = val; }
+        SqrtTreeItem prefixAt(int layer, int i, int) const { return prefix[layer][i]; }
+        SqrtTreeItem suffixAt(int layer, int i, int) const { return suffix[layer][i]; }
+        void setPrefix(int layer, int i, int, const SqrtTreeItem &item) { prefix[layer].mut(i) = item; }
+        void setSuffix(int layer, int i, int, const SqrtTreeItem &item) { suffix[layer].mut(i) = item; }
+        void finishBlock(int, int, int) {}
+        SqrtTreeItem betweenAt(int layer, int k, int) const { return between[layer - 1][k]; }
+        void setBetween(int layer, int k, int, const SqrtTreeItem &item) { between[layer - 1].mut(k) = item; }
+
+        // bytes of the page tables, plus the pages that are not in seen yet
+        size_t memoryUsage(unordered_set<const void *> &seen) const {
+            size_t bytes = values.size() * sizeof(SqrtTreeItem);
+            auto count = [&](const CowArray &a) {
+                bytes += a.getPages().size() * sizeof(shared_ptr<vector<SqrtTreeItem>>);
+                for (const auto &page : a.getPages()) {
+                    if (seen.insert(page.get()).second) {
+                        bytes += page->size() * sizeof(SqrtTreeItem);
+                    }
+                }
+            };
+            count(arr);
+            for (const auto &a : prefix) count(a);
+            for (const auto &a : suffix) count(a);
+            for (const auto &a : between) count(a);
+            return bytes;
+        }
+
+        size_t memoryUsage() const {
+            unordered_set<const void *> seen;
+            return memoryUsage(seen);
+        }
+};
+
+// A persistent (versioned) SqrtTree.
+// The layout and the build/update/query walks are the ones of BasicSqrtTree, every version is a PagedStorage.
+// update(version, idx, val) copies the version's page tables, then rebuilds exactly what the
+// plain SqrtTree rebuilds, copying only the pages it writes.
+// So a new version costs the touched child blocks and between rows plus the page tables,
+// which is O(sqrt(n)) - the same order as the work of a single update - and not O(n).
+// Queries on any live version stay O(1), they only pay one extra indirection per access.
+class PersistentSqrtTree : private BasicSqrtTree<allocator<SqrtTreeItem>, int, PagedStorage> {
+    private:
+        typedef BasicSqrtTree<allocator<SqrtTreeItem>, int, PagedStorage> Tree;
+
+        // version v is versions[v - firstVersion], null once it has been released;
+        // the released versions at the front are popped, so the deque only spans the live range
+        // the storage of the tree is only the one update is writing, it is moved into versions afterwards
+        deque<unique_ptr<PagedStorage>> versions;
+        int firstVersion = 0;
+        int alive = 0;
+
+    public:
+        // version 0 holds the input array
+        PersistentSqrtTree(const vector<SqrtTreeItem> &a) : Tree(a) {
+            versions.emplace_back(new PagedStorage(move(store)));
+            alive = 1;
+        }
+
+        // query [l...r] as of the given version
+        SqrtTreeItem query(int version, int l, int r) const {
+            if (!isAlive(version)) {
+                cout << "Invalid version!" << std::endl;
+                return INT_MIN;
+            }
+            return Tree::query(*versions[version - firstVersion], l, r, 0);
+        }
+
+        // derive a new version from the given one with arr[idx] = val, returns the new version handle
+        int update(int version, int idx, const SqrtTreeItem &val) {
+            if (!isAlive(version)) {
+                cout << "Invalid version!" << std::endl;
+                return -1;
+            }
+            // copying a PagedStorage only copies the page tables, all the pages are shared
+            store = *versions[version - firstVersion];
+            Tree::update(idx, val);
+            versions.emplace_back(new PagedStorage(move(store)));
+            alive++;
+            return latest();
+        }
+
+        // the most recently created version
+        int latest() const {
+            return firstVersion + (int) versions.size() - 1;
+        }
+
+        bool isAlive(int version) const {
+            return version >= firstVersion && version - firstVersion < (int) versions.size()
+                && versions[version - firstVersion] != nullptr;
+        }
+
+        // drop a version, the pages that no other version shares are freed
+        void release(int version) {
+            if (isAlive(version)) {
+                versions[version - firstVersion].reset();
+                alive--;
+                while (!versions.empty() && versions.front() == nullptr) {
+                    versions.pop_front();
+                    firstVersion++;
+                }
+            }
+        }
+
+        // keep only the newest count versions, every version is popped once so this is amortized O(1)
+        // count is at least 1, the latest version always survives so that updates can go on from it
+        void retainLast(int count) {
+            count = max(count, 1);
+            int keepFrom = latest() - count + 1;
+            while (!versions.empty() && firstVersion < keepFrom) {
+                alive -= versions.front() != nullptr;
+                versions.pop_front();
+                firstVersion++;
+            }
+        }
+
+        int aliveVersions() const {
+            return alive;
+        }
+
+        // bytes held by the layout and all the live versions, every shared page is counted once
+        size_t memoryUsage() const {
+            unordered_set<const void *> seen;
+            size_t bytes = Tree::memoryUsage();
+            for (const auto &v : versions) {
+                if (v != nullptr) {
+                    bytes += v->memoryUsage(seen);
+                }
+            }
+            return bytes;
+        }
+};
+
+#endif
@@ -0,0 +1,391 @@
+#ifndef QUERY_SERVER
+#define QUERY_SERVER
+#include "BasicLibraries.h"
+#include "SqrtTree.h"
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <memory>
+#include <cstring>
+#include <cstdio>
+#include <cerrno>
+#include <array>
+#include <iomanip>
+#ifndef _WIN32
+#include <csignal>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
+using namespace std;
+
+// Lock-free single-producer single-consumer ring buffer.
+// head is only written by the consumer, tail only by the producer, each on its own cache line.
+template<typename T>
+class SpscQueue {
+    private:
+        vector<T> ring;
+        size_t mask;
+        alignas(64) atomic<size_t> head;
+        alignas(64) atomic<size_t> tail;
+
+    public:
+        // capacity is rounded up to a power of two
+        SpscQueue(size_t capacity) : head(0), tail(0) {
+            size_t size = 1;
+            while (size < capacity) {
+                size <<= 1;
+            }
+            ring.resize(size);
+            mask = size - 1;
+        }
+
+        bool tryPush(const T &item) {
+            size_t t = tail.load(memory_order_relaxed);
+            if (t - head.load(memory_order_acquire) > mask) {
+                return false;
+            }
+            ring[t & mask] = item;
+            tail.store(t + 1, memory_order_release);
+            return true;
+        }
+
+        bool tryPop(T &item) {
+            size_t h = head.load(memory_order_relaxed);
+            if (h == tail.load(memory_order_acquire)) {
+                return false;
+            }
+            item = ring[h & mask];
+            head.store(h + 1, memory_order_release);
+            return true;
+        }
+
+        void push(const T &item) {
+            while (!tryPush(item)) {
+                this_thread::yield();
+            }
+        }
+
+        T pop() {
+            T item;
+            while (!tryPop(item)) {
+                this_thread::yield();
+            }
+            return item;
+        }
+
+        // only meaningful on the consumer side: nothing is ready to pop right now
+        bool empty() const {
+            return head.load(memory_order_relaxed) == tail.load(memory_order_acquire);
+        }
+};
+
+#ifndef _WIN32
+
+// One batch of operations travelling through the pipeline, answers are filled by the executor
+struct OpBatch {
+    // ops[i] = {type, x, y} exactly like a line of a test file
+    vector<array<int, 3>> ops;
+    vector<SqrtTreeItem> answers;
+};
+
+struct ServeStats {
+    long long numQueries = 0;
+    long long numUpdates = 0;
+    // ops whose type is neither 0 nor 1, and updates with an index out of [0...n-1], skipped without an answer
+    long long numRejected = 0;
+    // the peer closed its end before reading every answer
+    bool hungUp = false;
+    double seconds = 0;
+};
+
+// Buffered integer reader over a file descriptor
+class FdReader {
+    private:
+        int fd;
+        vector<char> buf;
+        size_t pos, len;
+
+        bool fill() {
+            ssize_t got;
+            do {
+                got = read(fd, buf.data(), buf.size());
+            } while (got < 0 && errno == EINTR);
+            pos = 0;
+            len = got > 0 ? got : 0;
+            return len > 0;
+        }
+
+    public:
+        FdReader(int fd) : fd(fd), buf(1 << 20), pos(0), len(0) {}
+
+        // read the next (possibly negative) integer, false at end of stream
+        bool nextInt(int &x) {
+            char c;
+            do {
+                if (pos == len && !fill()) {
+                    return false;
+                }
+                c = buf[pos++];
+            } while (c != '-' && (c < '0' || c > '9'));
+            bool negative = c == '-';
+            long long value = negative ? 0 : c - '0';
+            while (true) {
+                if (pos == len && !fill()) {
+                    break;
+                }
+                c = buf[pos];
+                if (c < '0' || c > '9') {
+                    break;
+                }
+                value = value * 10 + (c - '0');
+                pos++;
+            }
+            x = (int)(negative ? -value : value);
+            return true;
+        }
+
+        // true if another integer already starts in the buffer, false if finding one needs a (blocking) read
+        bool buffered() {
+            while (pos < len && buf[pos] != '-' && (buf[pos] < '0' || buf[pos] > '9')) {
+                pos++;
+            }
+            return pos < len;
+        }
+};
+
+// write the whole buffer, false if the peer went away (EPIPE, SIGPIPE is ignored by runServer/runClient)
+bool writeAll(int fd, const char *data, size_t size) {
+    while (size > 0) {
+        ssize_t sent = write(fd, data, size);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += sent;
+        size -= sent;
+    }
+    return true;
+}
+
+// Serve one stream of operations from inFd, answers of the queries go to outFd, one per line.
+// The stream has the test file format: "n q", the n array values, then "0 l r" / "1 idx val"
+// operations until the end of the stream (q is ignored, so a test file can be piped in as is).
+// Parsing, execution and output formatting run on three threads connected by SPSC queues of
+// batches, so each stage works on a whole batch per hand-off and the reads/writes are large.
+ServeStats serveStream(int inFd, int outFd, size_t batchSize = 4096) {
+    const size_t QUEUE_BATCHES = 64;
+    ServeStats stats;
+    FdReader reader(inFd);
+
+    int n, q;
+    if (!reader.nextInt(n) || !reader.nextInt(q) || n <= 0) {
+        cerr << "Serve: invalid stream header" << endl;
+        return stats;
+    }
+    vector<SqrtTreeItem> arr(n);
+    for (int i = 0; i < n; i++) {
+        if (!reader.nextInt(arr[i])) {
+            cerr << "Serve: stream ended inside the array" << endl;
+            return stats;
+        }
+    }
+    SqrtTree tree(arr);
+
+    // parsed -> executor, executed -> writer, and the emptied batches back to the parser
+    SpscQueue<OpBatch *> parsed(QUEUE_BATCHES), executed(QUEUE_BATCHES), recycled(2 * QUEUE_BATCHES);
+    for (size_t i = 0; i < QUEUE_BATCHES; i++) {
+        OpBatch *batch = new OpBatch();
+        batch->ops.reserve(batchSize);
+        batch->answers.reserve(batchSize);
+        recycled.push(batch);
+    }
+
+    auto start = chrono::steady_clock::now();
+
+    // a null batch marks the end of the stream
+    thread parser([&]() {
+        bool more = true;
+        while (more) {
+            OpBatch *batch = recycled.pop();
+            batch->ops.clear();
+            while (batch->ops.size() < batchSize) {
+                int type, x, y;
+                if (!reader.nextInt(type) || !reader.nextInt(x) || !reader.nextInt(y)) {
+                    more = false;
+                    break;
+                }
+                batch->ops.push_back({ type, x, y });
+                // hand over what we have before blocking on the stream, an interactive client waits for these answers
+                if (!reader.buffered()) {
+                    break;
+                }
+            }
+            parsed.push(batch);
+        }
+        parsed.push(nullptr);
+    });
+
+    thread executor([&]() {
+        while (OpBatch *batch = parsed.pop()) {
+            batch->answers.clear();
+            for (const auto &op : batch->ops) {
+                if (op[0] == 1 && (op[1] < 0 || op[1] >= n)) {
+                    stats.numRejected++;
+                } else if (op[0] == 1) {
+                    tree.update(op[1], op[2]);
+                    stats.numUpdates++;
+                } else if (op[0] != 0) {
+                    stats.numRejected++;
+                } else {
+                    if (op[1] < 0 || op[2] >= n || op[1] > op[2]) {
+                        batch->answers.push_back(INT_MIN);
+                    } else {
+                        batch->answers.push_back(tree.query(op[1], op[2]));
+                    }
+                    stats.numQueries++;
+                }
+            }
+            executed.push(batch);
+        }
+        executed.push(nullptr);
+    });
+
+    thread writer([&]() {
+        string out;
+        out.reserve(1 << 20);
+        char number[16];
+        bool open = true;
+        while (OpBatch *batch = executed.pop()) {
+            for (SqrtTreeItem answer : batch->answers) {
+                int len = snprintf(number, sizeof(number), "%d\n", answer);
+                out.append(number, len);
+            }
+            recycled.push(batch);
+            // write when the buffer is big or the pipeline has nothing more ready, so answers never wait for later ops
+            if (out.size() >= (1 << 19) || (!out.empty() && executed.empty())) {
+                open = open && writeAll(outFd, out.data(), out.size());
+                out.clear();
+            }
+        }
+        if (open) {
+            open = writeAll(outFd, out.data(), out.size());
+        }
+        // the remaining answers were dropped, the executor still drains the stream
+        stats.hungUp = !open;
+    });
+
+    parser.join();
+    executor.join();
+    writer.join();
+    stats.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    OpBatch *batch;
+    while (recycled.tryPop(batch)) {
+        delete batch;
+    }
+    return stats;
+}
+
+void printServeStats(const ServeStats &stats) {
+    long long ops = stats.numQueries + stats.numUpdates;
+    cerr << "Served " << ops << " ops (" << stats.numQueries << " queries, " << stats.numUpdates
+        << " updates) in " << fixed << setprecision(3) << stats.seconds << " s: "
+        << setprecision(0) << (stats.seconds > 0 ? ops / stats.seconds : 0) << " ops/s" << endl;
+    if (stats.numRejected > 0) {
+        cerr << "Skipped " << stats.numRejected << " invalid ops (unknown type or update index out of range)" << endl;
+    }
+    if (stats.hungUp) {
+        cerr << "The client hung up before reading all the answers" << endl;
+    }
+}
+
+// Serve stdin to stdout when socketPath is empty, otherwise listen on a Unix-domain socket and
+// serve the connections one after another
+void runServer(const string &socketPath) {
+    // a peer that hangs up makes write fail with EPIPE instead of killing the server
+    signal(SIGPIPE, SIG_IGN);
+    if (socketPath.empty()) {
+        printServeStats(serveStream(STDIN_FILENO, STDOUT_FILENO));
+        return;
+    }
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (listener < 0 || socketPath.size() >= sizeof(addr.sun_path)) {
+        cerr << "Cannot create socket " << socketPath << endl;
+        return;
+    }
+    strcpy(addr.sun_path, socketPath.c_str());
+    unlink(socketPath.c_str());
+    if (bind(listener, (sockaddr *)&addr, sizeof(addr)) < 0 || listen(listener, 4) < 0) {
+        cerr << "Cannot listen on " << socketPath << endl;
+        close(listener);
+        return;
+    }
+    cerr << "Listening on " << socketPath << endl;
+    while (true) {
+        int conn = accept(listener, nullptr, nullptr);
+        if (conn < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        printServeStats(serveStream(conn, conn));
+        close(conn);
+    }
+    close(listener);
+}
+
+// Local client: stream a test file to the server on socketPath and print the answers to stdout
+void runClient(const string &socketPath, const string &inputFile) {
+    signal(SIGPIPE, SIG_IGN);
+    FILE *in = fopen(inputFile.c_str(), "rb");
+    if (in == nullptr) {
+        cerr << "Cannot open file " << inputFile << endl;
+        return;
+    }
+    int conn = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (conn < 0 || socketPath.size() >= sizeof(addr.sun_path)) {
+        cerr << "Cannot create socket " << socketPath << endl;
+        fclose(in);
+        return;
+    }
+    strcpy(addr.sun_path, socketPath.c_str());
+    if (connect(conn, (sockaddr *)&addr, sizeof(addr)) < 0) {
+        cerr << "Cannot connect to " << socketPath << endl;
+        fclose(in);
+        close(conn);
+        return;
+    }
+
+    // send on one thread and receive on this one, so neither side blocks on a full socket buffer
+    thread sender([&]() {
+        vector<char> buf(1 << 20);
+        size_t got;
+        while ((got = fread(buf.data(), 1, buf.size(), in)) > 0) {
+            if (!writeAll(conn, buf.data(), got)) break;
+        }
+        shutdown(conn, SHUT_WR);
+    });
+    vector<char> buf(1 << 20);
+    ssize_t got;
+    while ((got = read(conn, buf.data(), buf.size())) != 0) {
+        if (got < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        writeAll(STDOUT_FILENO, buf.data(), got);
+    }
+    sender.join();
+    fclose(in);
+    close(conn);
+}
+
+#endif // !_WIN32
+
+#endif
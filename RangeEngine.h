@@ -0,0 +1,397 @@
+#ifndef RANGE_ENGINE
+#define RANGE_ENGINE
+#include "BasicLibraries.h"
+#include "SqrtTree.h"
+#include "SegmentTree.h"
+#include "FenwickTree.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+using namespace std;
+
+// Sum over ranges behind one facade that moves between SqrtTree, FenwickTree and SegmentTree
+// as the workload changes. The engine counts the queries, point sets and range adds it serves
+// and the lengths of their ranges (log2 buckets), and every windowOps ops it prices the mix
+// on each backend with a small cost model. When another backend is cheaper by more than margin
+// for confirmWindows windows in a row, it is built from a snapshot of the values on a background
+// thread while the active one keeps serving; the updates that arrive meanwhile are logged and
+// replayed on the new backend, which then replaces the active one between two ops.
+// Old statistics are halved at every window so the engine follows the recent mix.
+// Not thread safe, like the trees: one thread calls the engine, the builder thread only owns its snapshot.
+enum EngineBackend { SQRT_BACKEND, FENWICK_BACKEND, SEGMENT_BACKEND, BACKEND_COUNT };
+
+const char *backendName(EngineBackend backend) {
+    switch (backend) {
+        case SQRT_BACKEND: return "SqrtTree";
+        case FENWICK_BACKEND: return "FenwickTree";
+        case SEGMENT_BACKEND: return "SegmentTree";
+        default: return "?";
+    }
+}
+
+struct RangeEngineConfig {
+    EngineBackend initial = SQRT_BACKEND;
+    // ops between two decisions
+    int windowOps = 1 << 12;
+    // another backend must cost less than (1 - margin) of the active one..., margin = 1 pins the initial backend
+    double margin = 0.3;
+    // ...in this many decisions in a row before it is built
+    int confirmWindows = 2;
+    // no rebuild starts during this many ops after a switch
+    long long cooldownOps = 1 << 14;
+    // false builds on the calling thread, the switch then happens in the op that decided it
+    bool background = true;
+};
+
+// One switch: when it happened and the statistics that caused it
+struct EngineSwitch {
+    long long op; // ops served when the new backend took over
+    double seconds; // since the engine was created
+    EngineBackend from, to;
+    double updateShare; // share of point sets and range adds in the statistics
+    double meanQueryLen, meanAddLen; // mean range length of the queries and of the range adds
+    double fromCost, toCost; // modelled ns per op of both backends when the rebuild started
+    long long replayed; // logged updates replayed on the new backend
+};
+
+class RangeEngine {
+    private:
+        static const int LEN_BUCKETS = 32;
+
+        struct Backends {
+            unique_ptr<SqrtTree> sqrt;
+            unique_ptr<FenwickTree> fenwick;
+            unique_ptr<SegmentTree> segment;
+        };
+
+        // an update logged during a rebuild: [l...r] += delta, l == r for a point set
+        struct LoggedUpdate {
+            int l, r, delta;
+        };
+
+        RangeEngineConfig config;
+        int n;
+        EngineBackend active;
+        Backends trees;
+
+        // values = base[i] + the range adds, which live in a difference array
+        // (added answers the point reads, diff gives the snapshot in O(n)); both exist after the first range add
+        vector<int> base, diff;
+        unique_ptr<FenwickTree> added;
+
+        // decayed statistics
+        double queries = 0, sets = 0, adds = 0;
+        double queryLen[LEN_BUCKETS] = {}, addLen[LEN_BUCKETS] = {};
+        int windowLeft;
+        long long ops = 0;
+
+        // hysteresis state
+        EngineBackend candidate;
+        int streak = 0;
+        long long lastSwitchOp = 0;
+
+        // background rebuild
+        bool rebuilding = false;
+        EngineBackend target;
+        Backends pending;
+        thread builder;
+        atomic<bool> built{false};
+        vector<LoggedUpdate> updateLog;
+        EngineSwitch pendingSwitch;
+
+        vector<EngineSwitch> history;
+        long long rebuilds = 0, discarded = 0, replayed = 0;
+        chrono::steady_clock::time_point created;
+
+        static int lenBucket(int len) {
+            return min(LEN_BUCKETS - 1, 31 - __builtin_clz(len));
+        }
+
+        // a typical length of the ranges in a bucket
+        static double bucketLen(int bucket) {
+            return bucket == 0 ? 1.0 : 1.5 * (double)(1 << bucket);
+        }
+
+        // Cost model in ns per op, fitted on SqrtTree/FenwickTree/SegmentTree timings for n = 2^14 ... 2^22:
+        // SqrtTree answers in O(1) but rebuilds O(sqrt(n)) slots per point update, FenwickTree walks
+        // log(n) cells for both, SegmentTree visits log(n) + 2 log(len) nodes and adds a range lazily.
+        double queryCost(EngineBackend backend, int bucket) const {
+            double lg = log2((double)n + 1);
+            switch (backend) {
+                case SQRT_BACKEND: return 60;
+                case FENWICK_BACKEND: return 4 * lg;
+                default: return 25 * lg + 30 * bucket;
+            }
+        }
+
+        double setCost(EngineBackend backend) const {
+            double lg = log2((double)n + 1);
+            switch (backend) {
+                case SQRT_BACKEND: return 6.5 * sqrt((double)n);
+                case FENWICK_BACKEND: return 4 * lg;
+                default: return 40 * lg;
+            }
+        }
+
+        // SqrtTree and FenwickTree apply a range add element by element,
+        // the walks of neighbouring elements share their upper Fenwick cells
+        double addCost(EngineBackend backend, int bucket) const {
+            double lg = log2((double)n + 1);
+            switch (backend) {
+                case SQRT_BACKEND: return bucketLen(bucket) * setCost(SQRT_BACKEND);
+                case FENWICK_BACKEND: return 4 * lg + bucketLen(bucket) * lg;
+                default: return 40 * lg + 40 * bucket;
+            }
+        }
+
+        int value(int idx) const {
+            return added ? base[idx] + added->getSum(idx) : base[idx];
+        }
+
+        void tick() {
+            ops++;
+            if (rebuilding && built.load(memory_order_acquire)) {
+                finishRebuild();
+            }
+            if (--windowLeft == 0) {
+                windowLeft = config.windowOps;
+                decide();
+            }
+        }
+
+        void decide() {
+            EngineBackend best = active;
+            for (int b = 0; b < BACKEND_COUNT; b++) {
+                if (cost((EngineBackend)b) < cost(best)) {
+                    best = (EngineBackend)b;
+                }
+            }
+            if (!rebuilding && best != active && cost(best) < (1 - config.margin) * cost(active)
+                && (history.empty() || ops - lastSwitchOp >= config.cooldownOps)) {
+                streak = best == candidate ? streak + 1 : 1;
+                candidate = best;
+                if (streak >= config.confirmWindows) {
+                    streak = 0;
+                    startRebuild(best);
+                }
+            } else {
+                streak = 0;
+            }
+            queries *= 0.5, sets *= 0.5, adds *= 0.5;
+            for (int b = 0; b < LEN_BUCKETS; b++) {
+                queryLen[b] *= 0.5, addLen[b] *= 0.5;
+            }
+        }
+
+        // values is moved into the backend, so a rebuild holds one copy of the array besides base
+        static void build(Backends &into, EngineBackend backend, vector<int> &&values) {
+            switch (backend) {
+                case SQRT_BACKEND: into.sqrt.reset(new SqrtTree(move(values))); break;
+                case FENWICK_BACKEND: into.fenwick.reset(new FenwickTree(move(values))); break;
+                default: into.segment.reset(new SegmentTree(values)); break;
+            }
+        }
+
+        // the values now, with room for the SqrtTree index part so that a move into it does not reallocate
+        vector<int> snapshot() const {
+            vector<int> values;
+            values.reserve(SqrtTree::storageSize(n));
+            values.assign(base.begin(), base.end());
+            if (added) {
+                int running = 0;
+                for (int i = 0; i < n; i++) {
+                    running += diff[i];
+                    values[i] += running;
+                }
+            }
+            return values;
+        }
+
+        void startRebuild(EngineBackend to) {
+            double total = queries + sets + adds;
+            pendingSwitch = EngineSwitch{0, 0, active, to, (sets + adds) / total,
+                meanLen(queryLen, queries), meanLen(addLen, adds), cost(active), cost(to), 0};
+            rebuilding = true;
+            target = to;
+            rebuilds++;
+            built.store(false, memory_order_relaxed);
+            if (!config.background) {
+                build(pending, to, snapshot());
+                built.store(true, memory_order_release);
+                finishRebuild();
+                return;
+            }
+            builder = thread([this, to, values = snapshot()]() mutable {
+                build(pending, to, move(values));
+                built.store(true, memory_order_release);
+            });
+        }
+
+        void finishRebuild() {
+            if (builder.joinable()) {
+                builder.join();
+            }
+            rebuilding = false;
+            // the mix may have turned back while the new backend was built
+            if (cost(target) >= cost(active)) {
+                pending = Backends();
+                updateLog.clear();
+                discarded++;
+                return;
+            }
+            for (const LoggedUpdate &u : updateLog) {
+                applyUpdate(pending, target, u);
+            }
+            pendingSwitch.op = ops;
+            pendingSwitch.seconds = chrono::duration<double>(chrono::steady_clock::now() - created).count();
+            pendingSwitch.replayed = updateLog.size();
+            replayed += updateLog.size();
+            updateLog.clear();
+            history.push_back(pendingSwitch);
+            trees = move(pending);
+            pending = Backends();
+            active = target;
+            lastSwitchOp = ops;
+        }
+
+        // apply a logged update to a backend built from older values, base/added already hold the new values
+        void applyUpdate(Backends &into, EngineBackend backend, const LoggedUpdate &u) {
+            switch (backend) {
+                case SQRT_BACKEND:
+                    for (int i = u.l; i <= u.r; i++) {
+                        into.sqrt->update(i, value(i));
+                    }
+                    break;
+                case FENWICK_BACKEND:
+                    for (int i = u.l; i <= u.r; i++) {
+                        into.fenwick->update(i, u.delta);
+                    }
+                    break;
+                default:
+                    into.segment->update(u.l, u.r, u.delta);
+                    break;
+            }
+        }
+
+        static double meanLen(const double *hist, double count) {
+            if (count <= 0) {
+                return 0;
+            }
+            double sum = 0;
+            for (int b = 0; b < LEN_BUCKETS; b++) {
+                sum += hist[b] * bucketLen(b);
+            }
+            return sum / count;
+        }
+
+    public:
+        RangeEngine(const vector<int> &a, const RangeEngineConfig &config = RangeEngineConfig())
+            : config(config), n(a.size()), active(config.initial), base(a), candidate(config.initial),
+            created(chrono::steady_clock::now()) {
+            windowLeft = this->config.windowOps;
+            build(trees, active, snapshot());
+        }
+
+        ~RangeEngine() {
+            if (builder.joinable()) {
+                builder.join();
+            }
+        }
+
+        RangeEngine(const RangeEngine &) = delete;
+        RangeEngine &operator=(const RangeEngine &) = delete;
+
+        // Sum range from l to r
+        SqrtTreeItem query(int l, int r) {
+            queries++;
+            queryLen[lenBucket(r - l + 1)]++;
+            SqrtTreeItem answer;
+            switch (active) {
+                case SQRT_BACKEND: answer = trees.sqrt->query(l, r); break;
+                case FENWICK_BACKEND: answer = trees.fenwick->query(l, r); break;
+                default: answer = trees.segment->query(l, r); break;
+            }
+            tick();
+            return answer;
+        }
+
+        // arr[idx] = val
+        void update(int idx, int val) {
+            sets++;
+            int delta = val - value(idx);
+            base[idx] += delta;
+            switch (active) {
+                case SQRT_BACKEND: trees.sqrt->update(idx, val); break;
+                case FENWICK_BACKEND: trees.fenwick->update(idx, delta); break;
+                default: trees.segment->set(idx, val); break;
+            }
+            if (rebuilding) {
+                updateLog.push_back({idx, idx, delta});
+            }
+            tick();
+        }
+
+        // arr[l...r] += delta
+        void addRange(int l, int r, int delta) {
+            adds++;
+            addLen[lenBucket(r - l + 1)]++;
+            if (!added) {
+                added.reset(new FenwickTree(vector<int>(n, 0)));
+                diff.assign(n + 1, 0);
+            }
+            added->update(l, delta);
+            if (r + 1 < n) {
+                added->update(r + 1, -delta);
+            }
+            diff[l] += delta;
+            diff[r + 1] -= delta;
+            LoggedUpdate u{l, r, delta};
+            applyUpdate(trees, active, u);
+            if (rebuilding) {
+                updateLog.push_back(u);
+            }
+            tick();
+        }
+
+        // Modelled ns per op of a backend for the current statistics
+        double cost(EngineBackend backend) const {
+            double total = queries + sets + adds;
+            if (total <= 0) {
+                return 0;
+            }
+            double sum = sets * setCost(backend);
+            for (int b = 0; b < LEN_BUCKETS; b++) {
+                sum += queryLen[b] * queryCost(backend, b) + addLen[b] * addCost(backend, b);
+            }
+            return sum / total;
+        }
+
+        // Wait for a running rebuild and switch (or discard it) now
+        void waitForRebuild() {
+            if (rebuilding) {
+                finishRebuild();
+            }
+        }
+
+        EngineBackend backend() const { return active; }
+        bool isRebuilding() const { return rebuilding; }
+        const vector<EngineSwitch> &switches() const { return history; }
+        long long rebuildCount() const { return rebuilds; }
+        long long discardedCount() const { return discarded; }
+        long long replayedCount() const { return replayed; }
+
+        // Bytes used by the active backend and the value copy the rebuilds start from
+        size_t memoryUsage() const {
+            size_t bytes = (base.size() + diff.size()) * sizeof(int);
+            if (added) {
+                bytes += added->memoryUsage();
+            }
+            switch (active) {
+                case SQRT_BACKEND: return bytes + trees.sqrt->memoryUsage();
+                case FENWICK_BACKEND: return bytes + trees.fenwick->memoryUsage();
+                default: return bytes + trees.segment->memoryUsage();
+            }
+        }
+};
+
+#endif
@@ -6,37 +6,48 @@
 using namespace std;
 
 
-class SegmentTree {
+//Allocator is used for tree and lazy, e.g. HugePageAllocator
+//Index is the type of positions and node numbers, long long for arrays with more than 2^31 - 1 elements
+//The nodes and the sums are the Allocator's value_type, long long when the sums outgrow int
+template<typename Allocator = allocator<int>, typename Index = int>
+class BasicSegmentTree {
+	//Reads the layout to prefetch the nodes of a query, see InterleavedExecutor.h
+	template<typename> friend struct QueryPrefetch;
+
 private:
-	vector<int> tree;
-	vector<int> lazy;
-	vector<int> arr;
+	typedef typename Allocator::value_type Item;
+
+	vector<Item, Allocator> tree;
+	vector<Item, Allocator> lazy;
 
-	int n; //Size of origin array
-	int size; //Size of segment tree;
+	Index n; //Size of origin array
+	Index size; //Size of segment tree;
 
     //Create Segment tree from origin array
-    void buildTree(int node, int start, int end) {
+    //The leaves are reached from left to right, so next reads the values once, in order
+    template<typename It>
+    void buildTree(Index node, Index start, Index end, It& next) {
         if (start == end) {
             // Leaf node
-            tree[node] = arr[start];
+            tree[node] = *next;
+            ++next;
             return;
         }
 
-        int mid = start + (end - start) / 2;
-        int leftChild = 2 * node + 1;
-        int rightChild = 2 * node + 2;
+        Index mid = start + (end - start) / 2;
+        Index leftChild = 2 * node + 1;
+        Index rightChild = 2 * node + 2;
 
         // Build leftChild and rightChild
-        buildTree(leftChild, start, mid);
-        buildTree(rightChild, mid + 1, end);
+        buildTree(leftChild, start, mid, next);
+        buildTree(rightChild, mid + 1, end, next);
 
         // Fusion leftChild and rightChild
         tree[node] = tree[leftChild] + tree[rightChild];
     }
 
     //Lazy propagation
-    void propagate(int node, int start, int end) {
+    void propagate(Index node, Index start, Index end) {
         if (lazy[node] != 0) {
             //Update current node
             tree[node] += (end - start + 1) * lazy[node];
@@ -53,7 +64,7 @@ private:
     }
 
     //Query sumRange
-    int queryRange(int node, int start, int end, int left, int right) {
+    Item queryRange(Index node, Index start, Index end, Index left, Index right) {
         //Lazy value passing before processing
         propagate(node, start, end);
 
@@ -68,15 +79,15 @@ private:
         }
 
         //Part of the query
-        int mid = start + (end - start) / 2;
-        int leftSum = queryRange(2 * node + 1, start, mid, left, right);
-        int rightSum = queryRange(2 * node + 2, mid + 1, end, left, right);
+        Index mid = start + (end - start) / 2;
+        Item leftSum = queryRange(2 * node + 1, start, mid, left, right);
+        Item rightSum = queryRange(2 * node + 2, mid + 1, end, left, right);
 
         return leftSum + rightSum;
     }
 
     //Update value at point
-    void updatePoint(int node, int start, int end, int idx, int val) {
+    void updatePoint(Index node, Index start, Index end, Index idx, Item val) {
         //Lazy value passing before processing
         propagate(node, start, end);
 
@@ -88,13 +99,12 @@ private:
         //Found updated node
         if (start == end) {
             tree[node] = val;
-            arr[idx] = val;
             return;
         }
 
-        int mid = start + (end - start) / 2;
-        int leftChild = 2 * node + 1;
-        int rightChild = 2 * node + 2;
+        Index mid = start + (end - start) / 2;
+        Index leftChild = 2 * node + 1;
+        Index rightChild = 2 * node + 2;
 
         //Update in suitable tree
         if (idx <= mid) {
@@ -104,12 +114,16 @@ private:
             updatePoint(rightChild, mid + 1, end, idx, val);
         }
 
+        //The other child may still hold a lazy add of a range update
+        propagate(leftChild, start, mid);
+        propagate(rightChild, mid + 1, end);
+
         //Update current node
         tree[node] = tree[leftChild] + tree[rightChild];
     }
 
     //Update range
-    void updateRange(int node, int start, int end, int left, int right, int val) {
+    void updateRange(Index node, Index start, Index end, Index left, Index right, Item val) {
         //Lazy value passing before processing
         propagate(node, start, end);
 
@@ -133,30 +147,53 @@ private:
         }
 
         //Part of query range
-        int mid = start + (end - start) / 2;
+        Index mid = start + (end - start) / 2;
         updateRange(2 * node + 1, start, mid, left, right, val);
         updateRange(2 * node + 2, mid + 1, end, left, right, val);
 
         //Update current node
         tree[node] = tree[2 * node + 1] + tree[2 * node + 2];
     }
-public:
-    SegmentTree(const vector<int>& input) {
-        arr = input;
-        n = input.size();
+
+    //Create tree over count values read from first
+    template<typename It>
+    void init(Index count, It first) {
+        n = count;
 
         //Calculate size of segment tree
         int height = (int)(ceil(log2(n)));
-        size = 2 * (int)pow(2, height) - 1;
+        size = 2 * ((Index)1 << height) - 1;
 
         tree.resize(size, 0);
         lazy.resize(size, 0);
 
-        buildTree(0, 0, n - 1);
+        buildTree(0, 0, n - 1, first);
+    }
+public:
+    //The values are only read, the tree keeps no copy of them (an rvalue vector binds here too)
+    BasicSegmentTree(const vector<int>& input, const Allocator& alloc = Allocator()) : tree(alloc), lazy(alloc) {
+        init(input.size(), input.begin());
     }
 
+    //Build from a range, e.g. a memory-mapped column, the leaves are read straight from it
+    //(an input iterator is read into a temporary vector first, its count is unknown)
+    template<typename InputIt, typename = typename iterator_traits<InputIt>::iterator_category>
+    BasicSegmentTree(InputIt first, InputIt last, const Allocator& alloc = Allocator()) : tree(alloc), lazy(alloc) {
+        if constexpr (is_base_of<forward_iterator_tag, typename iterator_traits<InputIt>::iterator_category>::value) {
+            init(distance(first, last), first);
+        }
+        else {
+            vector<Item> values(first, last);
+            init(values.size(), values.begin());
+        }
+    }
+
+#ifdef HAS_STD_SPAN
+    BasicSegmentTree(span<const int> input, const Allocator& alloc = Allocator()) : BasicSegmentTree(input.begin(), input.end(), alloc) {}
+#endif
+
     //Change value
-    void set(int idx, int val) {
+    void set(Index idx, Item val) {
         if (idx < 0 || idx >= n) {
             cout << "Invalid index!" << std::endl;
             return;
@@ -165,7 +202,7 @@ public:
     }
 
     //Update by adding value
-    void update(int left, int right, int val) {
+    void update(Index left, Index right, Item val) {
         if (left < 0 || right >= n || left > right) {
             cout << "Invalid query range!" << std::endl;
             return;
@@ -174,13 +211,21 @@ public:
     }
 
     //Sum range from left to right
-    int query(int left, int right) {
+    Item query(Index left, Index right) {
         if (left < 0 || right >= n || left > right) {
             cout << "Invalid query range!" << std::endl;
             return INT_MIN;
         }
         return queryRange(0, 0, n - 1, left, right);
     }
+
+    //Bytes used by the tree
+    size_t memoryUsage() const {
+        return (tree.size() + lazy.size()) * sizeof(Item);
+    }
 };
 
+typedef BasicSegmentTree<> SegmentTree;
+typedef BasicSegmentTree<allocator<long long>, long long> SegmentTree64;
+
 #endif
@@ -0,0 +1,103 @@
+#ifndef SHARDED_SQRT_TREE
+#define SHARDED_SQRT_TREE
+#include "BasicLibraries.h"
+#include "SqrtTree.h"
+#include <atomic>
+#include <memory>
+#include <shared_mutex>
+#include <mutex>
+#include <thread>
+using namespace std;
+
+// SqrtTree split into contiguous shards so that updates can run on several cores.
+// The array is cut into shards of 2^shardSizeLog elements, each shard owns its own SqrtTree
+// and its own lock, and lives on its own cache lines. Every shard publishes its total in an atomic
+// on a cache line of its own, and the whole shards in the middle of a query are combined from
+// these totals, so a query costs at most two shard queries plus one pass over the shard totals
+// (there is one shard per hardware thread by default, so that pass is short).
+// Updates of different shards share no lock and no cache line: the O(sqrt(shardSize)) rebuild
+// and the store of the new total only touch the shard being updated.
+// All methods are thread safe. A query that spans several shards is not an atomic snapshot:
+// it sees each shard as of the moment it read that shard.
+class ShardedSqrtTree {
+    private:
+        struct alignas(64) Shard {
+            mutable shared_mutex lock;
+            unique_ptr<SqrtTree> tree;
+            // first element of the shard and number of elements in it
+            int lBound, len;
+            // total of the shard, written under the shard lock, read without it
+            alignas(64) atomic<SqrtTreeItem> total;
+        };
+
+        int n, shardSizeLog;
+        vector<unique_ptr<Shard>> shards;
+
+        SqrtTreeItem queryShard(int s, int l, int r) const {
+            const Shard &shard = *shards[s];
+            shared_lock<shared_mutex> guard(shard.lock);
+            return shard.tree->query(l - shard.lBound, r - shard.lBound);
+        }
+
+    public:
+        // shardCount = 0 means one shard per hardware thread
+        ShardedSqrtTree(const vector<SqrtTreeItem> &a, int shardCount = 0) {
+            n = a.size();
+            if (shardCount <= 0) {
+                shardCount = max(1u, thread::hardware_concurrency());
+            }
+            shardCount = max(1, min(shardCount, n));
+            // round the shard size up to a power of two, so the shard of an index is a shift
+            shardSizeLog = log2Up((n + shardCount - 1) / shardCount);
+            int shardSize = 1 << shardSizeLog;
+            shardCount = (n + shardSize - 1) >> shardSizeLog;
+
+            shards.resize(shardCount);
+            // shards are independent, build each of them on its own thread
+            vector<thread> builders;
+            for (int s = 0; s < shardCount; s++) {
+                shards[s].reset(new Shard());
+                shards[s]->lBound = s << shardSizeLog;
+                shards[s]->len = min(shardSize, n - shards[s]->lBound);
+                builders.emplace_back([this, s, &a]() {
+                    Shard &shard = *shards[s];
+                    vector<SqrtTreeItem> part(a.begin() + shard.lBound, a.begin() + shard.lBound + shard.len);
+                    shard.tree.reset(new SqrtTree(part));
+                    shard.total.store(shard.tree->query(0, shard.len - 1), memory_order_relaxed);
+                });
+            }
+            for (auto &builder : builders) {
+                builder.join();
+            }
+        }
+
+        SqrtTreeItem query(int l, int r) const {
+            int lShard = l >> shardSizeLog;
+            int rShard = r >> shardSizeLog;
+            if (lShard == rShard) {
+                return queryShard(lShard, l, r);
+            }
+            // suffix of the left shard, whole shards in between, prefix of the right shard
+            SqrtTreeItem answer = queryShard(lShard, l, shards[lShard]->lBound + shards[lShard]->len - 1);
+            for (int s = lShard + 1; s < rShard; s++) {
+                answer = op(answer, shards[s]->total.load(memory_order_acquire));
+            }
+            return op(answer, queryShard(rShard, shards[rShard]->lBound, r));
+        }
+
+        void update(int idx, const SqrtTreeItem &val) {
+            int s = idx >> shardSizeLog;
+            Shard &shard = *shards[s];
+            // the total is stored under the shard lock, so two updates of the same shard cannot
+            // publish their totals out of order
+            unique_lock<shared_mutex> guard(shard.lock);
+            shard.tree->update(idx - shard.lBound, val);
+            shard.total.store(shard.tree->query(0, shard.len - 1), memory_order_release);
+        }
+
+        int shardCount() const {
+            return (int) shards.size();
+        }
+};
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef SPARSE_TABLE
+#define SPARSE_TABLE
+#include "BasicLibraries.h"
+using namespace std;
+
+// Static sparse table for argmin/argmax, the O(1) baseline for ArgSqrtTree.
+// table[k][i] is the position of the best element of [i...i + 2^k - 1], n log n positions in total.
+// There is no cheap update, the whole table would have to be rebuilt.
+// Compare is the same as for ArgSqrtTree, ties go to the leftmost position.
+template<typename Compare = less<int>>
+class ArgSparseTable {
+    private:
+        int n;
+        vector<int> arr, lg;
+        vector<vector<int>> table;
+        Compare cmp;
+
+        int better(int a, int b) const {
+            return cmp(arr[b], arr[a]) ? b : a;
+        }
+
+    public:
+        ArgSparseTable(const vector<int> &a) : n(a.size()), arr(a) {
+            lg.assign(n + 1, 0);
+            for (int i = 2; i <= n; i++) {
+                lg[i] = lg[i >> 1] + 1;
+            }
+            table.resize(lg[n] + 1);
+            table[0].resize(n);
+            for (int i = 0; i < n; i++) {
+                table[0][i] = i;
+            }
+            for (int k = 1; k < (int) table.size(); k++) {
+                int len = n - (1 << k) + 1;
+                table[k].resize(len);
+                for (int i = 0; i < len; i++) {
+                    table[k][i] = better(table[k - 1][i], table[k - 1][i + (1 << (k - 1))]);
+                }
+            }
+        }
+
+        // position of the best element of [l...r]
+        int query(int l, int r) const {
+            int k = lg[r - l + 1];
+            return better(table[k][l], table[k][r - (1 << k) + 1]);
+        }
+
+        size_t memoryUsage() const {
+            size_t bytes = (arr.size() + lg.size()) * sizeof(int);
+            for (const auto &level : table) {
+                bytes += level.size() * sizeof(int);
+            }
+            return bytes;
+        }
+};
+
+#endif
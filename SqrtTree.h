@@ -8,138 +8,283 @@ using namespace std;
 // we also have the log2(childBlockSize) which could be compute with the
 // formula log2(chilBlockSize) = ceil(layers[i] / 2) on layer i
 // a = (a + 1) >> 1 means that a = ceil(a / 2)
-SqrtTreeItem op(const SqrtTreeItem &a, const SqrtTreeItem &b) {
+// Item is SqrtTreeItem, or the wider value type of a tree like SqrtTree64
+template<typename Item>
+Item op(const Item &a, const Item &b) {
     return (a + b);
 }
 
 // find the ceil(log2(n))
-int log2Up(int n) {
+template<typename Index>
+int log2Up(Index n) {
     int res = 0;
-    while ((1 << res) < n) {
+    while (((Index)1 << res) < n) {
         res++;
     }
     return res;
 }
 
+// The default storage of a BasicSqrtTree: every slot is an Item (the Allocator's value_type) and the slots are combined with op.
+// Allocator is used for the big arrays (arr, prefix, suffix, between), e.g. HugePageAllocator
+template<typename Allocator, typename Index>
+class SqrtTreeArrays {
+    // reads the arrays to prefetch the slots of a query, see InterleavedExecutor.h
+    template<typename> friend struct QueryPrefetch;
+
+    public:
+        typedef typename Allocator::value_type Item;
+        typedef vector<Item, Allocator> ItemVector;
+        // the values are the leaves as is, so a vector of them can be taken without a copy
+        typedef ItemVector ValueVector;
+
+    private:
+        Allocator alloc;
+        // the values [0...n-1], then the index part [n...n + indexSize - 1]
+        ItemVector arr;
+        // we can access a prefix of an element in a block by using prefix[layer][i].
+        // [layer] would give us a hint about the size of a block on a layer, then we can compute the child block size of that layer
+        // prefix[layer][i] is prefix of element i with the block size is the child block size on a layer
+        // assume that we have an array with len = 5: {1, 2, 3, 4, 5} -> layers[0] = 3 (because 2^3 = 8 > 5)
+        // so the block size is 2^3 = 8, child block size is 2^2 = 4
+        // -> the prefix would be {1, 3, 6, 10,(new block) 5};
+        // suffix is just like the prefix
+        // between[layer - 1] holds the packed between triangles of a layer, see BasicSqrtTree::betweenIndex
+        vector<ItemVector> prefix, suffix, between;
+
+    public:
+        explicit SqrtTreeArrays(const Allocator &alloc) : alloc(alloc), arr(alloc) {}
+
+        // take the values, the index part is added in place when a.capacity() is big enough
+        explicit SqrtTreeArrays(ItemVector &&a) : alloc(a.get_allocator()), arr(move(a)) {}
+
+        // copy the values, with room for capacity elements so that the index part does not reallocate
+        template<typename InputIt>
+        void assign(InputIt first, InputIt last, size_t capacity) {
+            arr.reserve(capacity);
+            arr.assign(first, last);
+        }
+
+        Index valueCount() const {
+            return arr.size();
+        }
+
+        // betweenSizes[layer - 1] is the number of between slots of a layer
+        void allocate(Index n, Index indexSize, const vector<int> &layers, const vector<Index> &betweenSizes) {
+            arr.resize(n + indexSize);
+            // we assign the default value for every element in prefix and suffix array
+            prefix.assign(layers.size(), ItemVector(n + indexSize, 0, alloc));
+            suffix.assign(layers.size(), ItemVector(n + indexSize, 0, alloc));
+            between.assign(betweenSizes.size(), ItemVector(alloc));
+            for (int layer = 0; layer < (int) betweenSizes.size(); layer++) {
+                between[layer].assign(betweenSizes[layer], 0);
+            }
+        }
+
+        Item op(const Item &a, const Item &b) const {
+            return ::op(a, b);
+        }
+
+        Item leaf(Index i) const {
+            return arr[i];
+        }
+
+        void setLeaf(Index i, const Item &item) {
+            arr[i] = item;
+        }
+
+        void setValue(Index i, const Item &val) {
+            arr[i] = val;
+        }
+
+        // start is the first element of the child block of i, plain arrays do not need it
+        Item prefixAt(int layer, Index i, Index) const {
+            return prefix[layer][i];
+        }
+
+        Item suffixAt(int layer, Index i, Index) const {
+            return suffix[layer][i];
+        }
+
+        void setPrefix(int layer, Index i, Index, const Item &item) {
+            prefix[layer][i] = item;
+        }
+
+        void setSuffix(int layer, Index i, Index, const Item &item) {
+            suffix[layer][i] = item;
+        }
+
+        void finishBlock(int, Index, Index) {}
+
+        Item betweenAt(int layer, Index k, Index) const {
+            return between[layer - 1][k];
+        }
+
+        void setBetween(int layer, Index k, Index, const Item &item) {
+            between[layer - 1][k] = item;
+        }
+
+        // bytes used by the between arrays
+        size_t betweenMemoryUsage() const {
+            size_t bytes = 0;
+            for (const auto &layer : between) {
+                bytes += layer.size() * sizeof(Item);
+            }
+            return bytes;
+        }
+
+        size_t memoryUsage() const {
+            size_t bytes = arr.size() * sizeof(Item);
+            for (int layer = 0; layer < (int) prefix.size(); layer++) {
+                bytes += (prefix[layer].size() + suffix[layer].size()) * sizeof(Item);
+            }
+            return bytes + betweenMemoryUsage();
+        }
+};
+
 // at a layer, we have the layers[i] is the blockSize on that layer
 // we also have the log2(childBlockSize) which could be compute with the
 // formula log2(chilBlockSize) = ceil(layers[i] / 2) on layer i
 // a = (a + 1) >> 1 means that a = ceil(a / 2)
-class SqrtTree {
+// Allocator is the allocator of the default storage, e.g. HugePageAllocator
+// Index is the type of the positions and sizes: int up to 2^31 - 1 elements, long long beyond that
+// the values, the answers and the sums are kept as the Allocator's value_type, e.g. long long when the sums outgrow int
+// Storage keeps the slots (arr, prefix, suffix, between): what a slot holds, how two slots are combined and where they live.
+// The tree lays out the layers, the blocks and the between triangles and walks them, the storage is asked for:
+// - Item, the type of the slots and the answers, and ValueVector, a vector of the input values
+// - op(a, b), a is the slot on the left
+// - leaf(i) and setLeaf(i, item) for arr, setValue(i, val) for arr[i] = val with i < n
+// - prefixAt/suffixAt(layer, i, start) and setPrefix/setSuffix(layer, i, start, item) for slot i of the child block
+//   that begins at start, then finishBlock(layer, l, r) once all the slots of the child block [l...r) are set
+// - betweenAt(layer, k, lBound) and setBetween(layer, k, lBound, item) for slot k of between[layer - 1], lBound is the
+//   first element of the layer block
+// - a constructor from the Allocator and one from a ValueVector&&, assign(first, last, capacity), valueCount(),
+//   allocate(n, indexSize, layers, betweenSizes) and memoryUsage()
+// MultiSqrtTree, ArgSqrtTree, CompactSqrtTree and PersistentSqrtTree are BasicSqrtTrees with their own storage
+template<typename Allocator = allocator<SqrtTreeItem>, typename Index = int, typename Storage = SqrtTreeArrays<Allocator, Index>>
+class BasicSqrtTree {
+    // reads the layout to prefetch the slots of a query, see InterleavedExecutor.h
+    template<typename> friend struct QueryPrefetch;
+
+    public:
+        typedef typename Storage::Item Item;
+        typedef typename Storage::ValueVector::value_type Value;
+
     private:
         // ceilLog store the minimum k that 2^k >= n (n is input array size)
         // indexSize is number of blocks on the first layer
-        int ceilLog, n, indexSize;
+        int ceilLog;
+        Index n, indexSize;
         // clz[i] is the highest (left most) bit 1 of number i
         // Ex: number 5 would be represented 0101, so the highest bit is 3 (counted from right to left) -> clz[5] = 3
+        // the table has 2^ceilLog entries, so with a 64-bit Index it is left empty and the bit is found with the builtin
         // layers: k = layers[i] is the log2(blockSize) on that layer
         // onLayer[i] is the block with size 2^i belongs to the layer onLayer[i], ex: onLayer[i] = 1 then the block size 2^2 is on layer 1
         vector<int> clz, layers, onLayer;
-        vector<SqrtTreeItem> arr;
-        // we can access a prefix of an element in a block by using prefix[layer][i].
-        // [layer] would give us a hint about the size of a block on a layer, then we can compute the child block size of that layer
-        // prefix[layer][i] is prefix of element i with the block size is the child block size on a layer
-        // assume that we have an array with len = 5: {1, 2, 3, 4, 5} -> layers[0] = 3 (because 2^3 = 8 > 5)
-        // so the block size is 2^3 = 8, child block size is 2^2 = 4
-        // -> the prefix would be {1, 3, 6, 10,(new block) 5};
-        // suffix is just like the prefix
         // between is a matrix that holds answers for the queries for sequences of whole child blocks on a layer
-        // instead of accessing between using between[layer][i][j] -> 3d array, we convert [i][j] into [i * rowElements + j]
-        // so we can access between using between[layer][i * rowElements + j]
-        vector<vector<SqrtTreeItem>> prefix, suffix, between;
+        // only the entries with j >= i are ever used, so every block keeps just the upper triangle of its matrix, packed row by row:
+        // row i starts at i * childBlocksCount - i * (i - 1) / 2, and [i][j] is at rowStart(i) + (j - i)
+        // the triangles of the blocks on a layer are stored one after another, so between[layer] is sized to the real number of blocks
+        // triangleSize[layer] is the size of the packed triangle of a full block on that layer
+        // indexBetweenStart[layer] is where the triangles of the [n...n + indexSize - 1] part begin in between[layer]
+        vector<int> triangleSize;
+        vector<Index> indexBetweenStart;
+
+        static constexpr bool wideIndex = sizeof(Index) > sizeof(int);
+
+    protected:
+        Storage store;
+
+    private:
+        // clz[x], for x > 0
+        int highestBit(Index x) const {
+            if constexpr (wideIndex) {
+                return 64 - __builtin_clzll((unsigned long long)x);
+            } else {
+                return clz[x];
+            }
+        }
+
+        // position in between[layer - 1] of the answer for the child blocks [i...j] of the block that begins at lBound
+        // base is 0 for the original array and n for the index part
+        Index betweenIndex(int layer, Index base, Index lBound, Index i, Index j) const {
+            int childBlocksCountLog = layers[layer] >> 1;
+            Index block = (lBound - base) >> layers[layer];
+            Index start = base == 0 ? 0 : indexBetweenStart[layer - 1];
+            return start + block * triangleSize[layer] + (i << childBlocksCountLog) - ((i * (i - 1)) >> 1) + (j - i);
+        }
+
+        // number of between elements needed on a layer for a part of the array with len elements
+        Index betweenSize(int layer, Index len) const {
+            int childBlockSizeLog = (layers[layer] + 1) >> 1;
+            Index blocks = (len + ((Index)1 << layers[layer]) - 1) >> layers[layer];
+            // every block but the last one is full
+            int lastLen = len - ((blocks - 1) << layers[layer]);
+            int lastCount = (lastLen + (1 << childBlockSizeLog) - 1) >> childBlockSizeLog;
+            int lastSize = ((lastCount - 1) << (layers[layer] >> 1)) - (((lastCount - 1) * (lastCount - 2)) >> 1) + 1;
+            return (blocks - 1) * triangleSize[layer] + lastSize;
+        }
 
         // build prefix and suffix for a [l...r) block on a layer
-        void buildBlock(int layer, int l, int r) {
-            prefix[layer][l] = arr[l];
-            for (int i = l + 1; i < r; i++) {
-                prefix[layer][i] = op(prefix[layer][i - 1], arr[i]);
+        void buildBlock(int layer, Index l, Index r) {
+            Item answer = store.leaf(l);
+            store.setPrefix(layer, l, l, answer);
+            for (Index i = l + 1; i < r; i++) {
+                answer = store.op(answer, store.leaf(i));
+                store.setPrefix(layer, i, l, answer);
             }
-            suffix[layer][r - 1] = arr[r - 1];
-            for (int i = r - 2; i >= l; i--) {
-                suffix[layer][i] = op(arr[i], suffix[layer][i + 1]);
+            answer = store.leaf(r - 1);
+            store.setSuffix(layer, r - 1, l, answer);
+            for (Index i = r - 2; i >= l; i--) {
+                answer = store.op(store.leaf(i), answer);
+                store.setSuffix(layer, i, l, answer);
             }
+            store.finishBlock(layer, l, r);
         }
 
         // build index for first layer
         void buildBetweenZero() {
             int childBlockSizeLog = (ceilLog + 1) >> 1;
-            for (int i = 0; i < indexSize; i++) {
+            for (Index i = 0; i < indexSize; i++) {
                 // assign each child block answers
-                arr[n + i] = suffix[0][i << childBlockSizeLog];
+                Index start = i << childBlockSizeLog;
+                store.setLeaf(n + i, store.suffixAt(0, start, start));
             }
-            // build [n...n + indexSize - 1] as a separate SqrtTree with betweenOffset
-            build(1, n, n + indexSize, (1 << ceilLog) - n);
+            // build [n...n + indexSize - 1] as a separate SqrtTree with base n
+            build(1, n, n + indexSize, n);
         }
 
-        void buildBetween(int layer, int lBound, int rBound, int betweenOffset) {
+        void buildBetween(int layer, Index lBound, Index rBound, Index base) {
             int childBlockSizeLog = (layers[layer] + 1) >> 1;
-            int childBlocksCountLog = layers[layer] >> 1;
             int childBlockSize = 1 << childBlockSizeLog;
             // childBlocksCount = ceil((rBound - lBound) / childBlockSize)
             int childBlocksCount = (rBound - lBound + childBlockSize - 1) >> childBlockSizeLog;
             for (int i = 0; i < childBlocksCount; i++) {
-                // init empty answer
-                SqrtTreeItem answer = 0;
-                for (int j = i; j < childBlocksCount; j++) {
-                    SqrtTreeItem add = suffix[layer][lBound + (j << childBlockSizeLog)];
+                // the answers of row i are contiguous in the packed triangle, [i][j] is at row + j
+                Index row = betweenIndex(layer, base, lBound, i, i) - i;
+                Index start = lBound + ((Index)i << childBlockSizeLog);
+                Item answer = store.suffixAt(layer, start, start);
+                store.setBetween(layer, row + i, lBound, answer);
+                for (int j = i + 1; j < childBlocksCount; j++) {
                     // accumulating answer
-                    if (i == j) {
-                        answer = add;    
-                    } else {
-                        answer = op(answer, add);
-                    }
-                    // access the right place in between to assign the answer
-                    between[layer - 1][betweenOffset + lBound + (i << childBlocksCountLog) + j] = answer;
-                }
-            }
-        }
-
-        SqrtTreeItem query(int l, int r, int betweenOffset, int base) {
-            // just one element
-            if (l == r) {
-                return arr[l];
-            } else if (l + 1 == r) { // 2 elements
-                return op(arr[l], arr[r]);
-            }
-            // find the layer that l and r are in the same block (not child block)
-            int layer = onLayer[clz[(l - base) ^ (r - base)]];
-            int childBlockSizeLog = (layers[layer] + 1) >> 1;
-            int childBlockSize = 1 << childBlockSizeLog;
-            int childBlocksCountLog = layers[layer] >> 1;
-            // find the beginning child block that contains l
-            // turn off all the unecessary bits to access the beginning of the block
-            int lBound = (((l - base) >> layers[layer]) << layers[layer]) + base;
-            
-            // find between range (child block)
-            int lBlock = ((l - lBound) >> childBlockSizeLog) + 1;
-            int rBlock = ((r - lBound) >> childBlockSizeLog) - 1;
-            SqrtTreeItem answer = suffix[layer][l];
-            if (lBlock <= rBlock) {
-                SqrtTreeItem add;
-                // special case, we query using index array
-                if (layer == 0) {
-                    add = query(n + lBlock, n + rBlock, (1 << ceilLog) - n, n);
-                } else {
-                    // access the right answer in between array
-                    add = between[layer - 1][betweenOffset + lBound + (lBlock << childBlocksCountLog) + rBlock];
+                    start = lBound + ((Index)j << childBlockSizeLog);
+                    answer = store.op(answer, store.suffixAt(layer, start, start));
+                    store.setBetween(layer, row + j, lBound, answer);
                 }
-                answer = op(answer, add);
             }
-            answer = op(answer, prefix[layer][r]);
-            return answer;
         }
 
-        void updateBetweenZero(int blockIdx) {
+        void updateBetweenZero(Index blockIdx) {
             int childBlockSizeLog = (ceilLog + 1) >> 1;
-            arr[n + blockIdx] = suffix[0][blockIdx << childBlockSizeLog];
-            update(1, n, n + indexSize, (1 << ceilLog) - n, n + blockIdx);
+            Index start = blockIdx << childBlockSizeLog;
+            store.setLeaf(n + blockIdx, store.suffixAt(0, start, start));
+            update(1, n, n + indexSize, n, n + blockIdx);
         }
 
         // build prefix, suffix and between for current layer in [lBound...rBound]
-        // we have a parameter called betweenOffset. This parameter is used for [n...n + idxSize - 1] in array
+        // we have a parameter called base. This parameter is used for [n...n + idxSize - 1] in array
         // because the lBound for the first child block of the [n...n + idxSize - 1] would be n
-        // we want to build the "between" FROM [1 << ceilLog], so we need to pass in a parameter called betweenOffset to make buildBetween function begin from [1 << ceilLog] between[layer] array.
-        void build(int layer, int lBound, int rBound, int betweenOffset) {
+        // the blocks of that part are counted from n and their "between" triangles are stored after the ones of the original array (from indexBetweenStart)
+        void build(int layer, Index lBound, Index rBound, Index base) {
             // base case: there is no more layer to build
             if (layer >= (int) layers.size()) {
                 return;
@@ -147,62 +292,113 @@ class SqrtTree {
             int childBlockSizeLog = (layers[layer] + 1) >> 1;
             int childBlockSize = 1 << childBlockSizeLog;
             // build each child block iteratively
-            for (int l = lBound; l < rBound; l += childBlockSize) {
+            for (Index l = lBound; l < rBound; l += childBlockSize) {
                 // we could have some un-full block (ex: the child block size was 3 but we only got 2 elements left)
-                int r = min(l + childBlockSize, rBound);
+                Index r = min<Index>(l + childBlockSize, rBound);
                 buildBlock(layer, l, r);
                 // recursively build next layers for current child block
-                build(layer + 1, l, r, betweenOffset);
+                build(layer + 1, l, r, base);
             }
             // special case: first layer do not use a between
             if (layer == 0) {
                 // just build that layer
                 buildBetweenZero();
             } else {
-                buildBetween(layer, lBound, rBound, betweenOffset);
+                buildBetween(layer, lBound, rBound, base);
             }
         }
-        
-        void update(int layer, int lBound, int rBound, int betweenOffset, int x) {
+
+        void update(int layer, Index lBound, Index rBound, Index base, Index x) {
             if (layer >= (int)layers.size()) {
                 return;
             }
             int bSzLog = (layers[layer] + 1) >> 1;
             int bSz = 1 << bSzLog;
-            int blockIdx = (x - lBound) >> bSzLog;
-            int l = lBound + (blockIdx << bSzLog);
-            int r = min(l + bSz, rBound);
+            Index blockIdx = (x - lBound) >> bSzLog;
+            Index l = lBound + (blockIdx << bSzLog);
+            Index r = min<Index>(l + bSz, rBound);
             buildBlock(layer, l, r);
             if (layer == 0) {
                 updateBetweenZero(blockIdx);
             } else {
-                buildBetween(layer, lBound, rBound, betweenOffset);
+                buildBetween(layer, lBound, rBound, base);
             }
-            update(layer + 1, l, r, betweenOffset, x);
+            update(layer + 1, l, r, base, x);
+        }
+
+    protected:
+        // query on the slots of s, a storage with the layout of this tree (PersistentSqrtTree keeps one per version)
+        Item query(const Storage &s, Index l, Index r, Index base) const {
+            // just one element
+            if (l == r) {
+                return s.leaf(l);
+            } else if (l + 1 == r) { // 2 elements
+                return s.op(s.leaf(l), s.leaf(r));
+            }
+            // find the layer that l and r are in the same block (not child block)
+            int layer = onLayer[highestBit((l - base) ^ (r - base))];
+            int childBlockSizeLog = (layers[layer] + 1) >> 1;
+            // find the beginning child block that contains l
+            // turn off all the unecessary bits to access the beginning of the block
+            Index lBound = (((l - base) >> layers[layer]) << layers[layer]) + base;
+
+            // find between range (child block)
+            Index lBlock = ((l - lBound) >> childBlockSizeLog) + 1;
+            Index rBlock = ((r - lBound) >> childBlockSizeLog) - 1;
+            Item answer = s.suffixAt(layer, l, lBound + ((lBlock - 1) << childBlockSizeLog));
+            if (lBlock <= rBlock) {
+                Item add;
+                // special case, we query using index array
+                if (layer == 0) {
+                    add = query(s, n + lBlock, n + rBlock, n);
+                } else {
+                    // access the right answer in between array
+                    add = s.betweenAt(layer, betweenIndex(layer, base, lBound, lBlock, rBlock), lBound);
+                }
+                answer = s.op(answer, add);
+            }
+            answer = s.op(answer, s.prefixAt(layer, r, lBound + ((rBlock + 1) << childBlockSizeLog)));
+            return answer;
         }
 
-    
     public:
-        SqrtTreeItem query(int l, int r) {
-            return query(l, r, 0, 0);
+        // bytes used by the between arrays
+        size_t betweenMemoryUsage() const {
+            return store.betweenMemoryUsage();
+        }
+
+        // bytes the between arrays would take as full (1 << ceilLog) + childBlockSize squares, for comparison
+        size_t squareBetweenMemoryUsage() const {
+            size_t childBlockSize = (size_t)1 << ((ceilLog + 1) >> 1);
+            return indexBetweenStart.size() * (((size_t)1 << ceilLog) + childBlockSize) * sizeof(Item);
+        }
+
+        // bytes used by the whole tree
+        size_t memoryUsage() const {
+            size_t bytes = (clz.size() + layers.size() + onLayer.size() + triangleSize.size()) * sizeof(int) + indexBetweenStart.size() * sizeof(Index);
+            return bytes + store.memoryUsage();
         }
 
-        void update(int idx, const SqrtTreeItem &val) {
-            arr[idx] = val;
+        Item query(Index l, Index r) const {
+            return query(store, l, r, 0);
+        }
+
+        void update(Index idx, const Value &val) {
+            store.setValue(idx, val);
             update(0, 0, n, 0, idx);
         }
 
-        SqrtTree(const vector<SqrtTreeItem> &a) {
-            arr = a;
-            n = arr.size();
+    private:
+        // lay out and build the tree over the values in the storage
+        void init() {
+            n = store.valueCount();
             ceilLog = log2Up(n);
-            clz.assign(1 << ceilLog, 0);
+            clz.assign(wideIndex ? 0 : (size_t)1 << ceilLog, 0);
             onLayer.assign(ceilLog + 1, 0);
             layers.clear();
 
             // algorithm to compute clz
-            clz[0] = 0; // base case
-            for (int i = 1; i < clz.size(); i++) {
+            for (size_t i = 1; i < clz.size(); i++) {
                 clz[i] = clz[i >> 1] + 1;
             }
             int tempLog = ceilLog;
@@ -226,21 +422,63 @@ class SqrtTree {
             // indexSize is the number of child blocks on layer 0 (first layer)
             // indexSize = ceil(n / childBlockSize)
             indexSize = (n + childBlockSize - 1) >> childBlockSizeLog;
+            // for every layer (except the first one), we create a array to holds the answers for all queries from a whole child block to another whole child blocks
+            // this array has two part too, first part holds the triangles of the blocks of the original array [0...n-1]
+            // the second part is for the blocks of [n...n + indexSize-1], the index is a separate SqrtTree starting at layer 1
+            triangleSize.assign(layers.size(), 0);
+            indexBetweenStart.assign(betweenLayers, 0);
+            vector<Index> betweenSizes(betweenLayers);
+            for (int layer = 1; layer < (int) layers.size(); layer++) {
+                int childBlocksCount = 1 << (layers[layer] >> 1);
+                triangleSize[layer] = childBlocksCount * (childBlocksCount + 1) / 2;
+                indexBetweenStart[layer - 1] = betweenSize(layer, n);
+                betweenSizes[layer - 1] = indexBetweenStart[layer - 1] + betweenSize(layer, indexSize);
+            }
             // add indexSize space to the array for child blocks
             // [n...n + indexSize - 1] is a subarray that each elements is the answer of a childBlock in the original array [0...n-1]
-            arr.resize(n + indexSize);
             // each layer has a prefix and suffix, we treat first n elements as an array, next indexSize elements as an another distinct array array
-            // we assign the default value for every element in prefix and suffix array
-            prefix.assign(layers.size(), vector<SqrtTreeItem>(n + indexSize, 0));
-            suffix.assign(layers.size(), vector<SqrtTreeItem>(n + indexSize, 0));
-            // for every layer (except the first one), we create a array to holds the answers for all queries from a whole child block to another whole child blocks
-            // this array has two part too, first (1 << ceilLog or 2^ceilLog) elements will holds the answers for childBlocks on layer - 1
-            // the remaining (childBlockSize elements) is for all elements that we put at [n...n + indexSize-1] in the original array
-            // we might not use all the space that we assigned (because 1 << ceilLog is >= n)
-            between.assign(betweenLayers, vector<SqrtTreeItem>((1 << ceilLog) + childBlockSize, 0));
+            store.allocate(n, indexSize, layers, betweenSizes);
             // build the whole tree.
             build(0, 0, n, 0);
         }
+
+    public:
+        // number of elements arr needs for n values: the values and the index part after them
+        static Index storageSize(Index n) {
+            int childBlockSizeLog = (log2Up(n) + 1) >> 1;
+            return n + ((n + ((Index)1 << childBlockSizeLog) - 1) >> childBlockSizeLog);
+        }
+
+        BasicSqrtTree(const vector<SqrtTreeItem> &a, const Allocator &alloc = Allocator()) : store(alloc) {
+            store.assign(a.begin(), a.end(), storageSize(a.size()));
+            init();
+        }
+
+        // take the values without copying them, the index part is added in place
+        // when a.capacity() >= storageSize(a.size()), otherwise arr is reallocated once
+        BasicSqrtTree(typename Storage::ValueVector &&a) : store(move(a)) {
+            init();
+        }
+
+        // build from a range, e.g. a memory-mapped column, the values are copied once into arr
+        // (with an input iterator the count is unknown and arr may be reallocated while it fills)
+        template<typename InputIt, typename = typename iterator_traits<InputIt>::iterator_category>
+        BasicSqrtTree(InputIt first, InputIt last, const Allocator &alloc = Allocator()) : store(alloc) {
+            size_t capacity = 0;
+            if constexpr (is_base_of<forward_iterator_tag, typename iterator_traits<InputIt>::iterator_category>::value) {
+                capacity = storageSize(distance(first, last));
+            }
+            store.assign(first, last, capacity);
+            init();
+        }
+
+#ifdef HAS_STD_SPAN
+        BasicSqrtTree(span<const SqrtTreeItem> a, const Allocator &alloc = Allocator()) : BasicSqrtTree(a.begin(), a.end(), alloc) {}
+#endif
 };
 
+typedef BasicSqrtTree<> SqrtTree;
+// for arrays with more than 2^31 - 1 elements, whose sums do not fit in an int either
+typedef BasicSqrtTree<allocator<long long>, long long> SqrtTree64;
+
 #endif
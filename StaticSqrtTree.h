@@ -0,0 +1,263 @@
+#ifndef STATIC_SQRT_TREE
+#define STATIC_SQRT_TREE
+#include "BasicLibraries.h"
+#include <array>
+#include <type_traits>
+using namespace std;
+
+// SqrtTree whose size N is known at compile time.
+// ceilLog, layers, onLayer, indexSize and the offset of every prefix/suffix/between layer are
+// computed by a constexpr function, so the query arithmetic works on constants and nothing is set
+// up at runtime. All the data lives in one flat buffer of bufferSize elements:
+// [arr (N + indexSize)] [prefix of every layer] [suffix of every layer] [between of every layer]
+// The buffer is a member std::array by default (no heap at all), or a caller-provided T* when
+// External is true. With the std::array storage the tree can be built and queried in constexpr
+// contexts (for small N, the compiler's constexpr step limit applies).
+// Op is a functor with constexpr T operator()(const T&, const T&) const, it must be associative.
+
+// Sum, the default operation of SqrtTree
+template<typename T>
+struct StaticSumOp {
+    constexpr T operator()(const T &a, const T &b) const {
+        return a + b;
+    }
+};
+
+// the position of the highest bit 1 of x counted from 1 (0 for x = 0), the same as clz[x] in SqrtTree
+constexpr int staticHighestBit(unsigned x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return x == 0 ? 0 : 32 - __builtin_clz(x);
+#else
+    int res = 0;
+    while (x > 0) {
+        x >>= 1;
+        res++;
+    }
+    return res;
+#endif
+}
+
+// every table of a StaticSqrtTree<N>, the meaning of each field is the same as in SqrtTree
+struct StaticSqrtLayout {
+    int ceilLog, layerCount, indexSize, arrSize;
+    int layers[32];
+    int onLayer[33];
+    int triangleSize[32];
+    // offsets in the flat buffer
+    int prefixStart, suffixStart;
+    int betweenStart[32];
+    int indexBetweenStart[32];
+    int bufferSize;
+};
+
+constexpr int staticBetweenSize(const StaticSqrtLayout &layout, int layer, int len) {
+    int layerLog = layout.layers[layer];
+    int childBlockSizeLog = (layerLog + 1) >> 1;
+    int blocks = (len + (1 << layerLog) - 1) >> layerLog;
+    int lastLen = len - ((blocks - 1) << layerLog);
+    int lastCount = (lastLen + (1 << childBlockSizeLog) - 1) >> childBlockSizeLog;
+    int lastSize = ((lastCount - 1) << (layerLog >> 1)) - (((lastCount - 1) * (lastCount - 2)) >> 1) + 1;
+    return (blocks - 1) * layout.triangleSize[layer] + lastSize;
+}
+
+constexpr StaticSqrtLayout makeStaticSqrtLayout(int n) {
+    StaticSqrtLayout layout{};
+    int ceilLog = 0;
+    while ((1 << ceilLog) < n) {
+        ceilLog++;
+    }
+    layout.ceilLog = ceilLog;
+    int tempLog = ceilLog;
+    while (tempLog > 1) {
+        layout.onLayer[tempLog] = layout.layerCount;
+        layout.layers[layout.layerCount++] = tempLog;
+        tempLog = (tempLog + 1) >> 1;
+    }
+    for (int i = ceilLog - 1; i >= 0; i--) {
+        layout.onLayer[i] = layout.onLayer[i] > layout.onLayer[i + 1] ? layout.onLayer[i] : layout.onLayer[i + 1];
+    }
+    int childBlockSizeLog = (ceilLog + 1) >> 1;
+    layout.indexSize = (n + (1 << childBlockSizeLog) - 1) >> childBlockSizeLog;
+    layout.arrSize = n + layout.indexSize;
+    layout.prefixStart = layout.arrSize;
+    layout.suffixStart = layout.prefixStart + layout.layerCount * layout.arrSize;
+    int offset = layout.suffixStart + layout.layerCount * layout.arrSize;
+    for (int layer = 1; layer < layout.layerCount; layer++) {
+        int childBlocksCount = 1 << (layout.layers[layer] >> 1);
+        layout.triangleSize[layer] = childBlocksCount * (childBlocksCount + 1) / 2;
+        layout.betweenStart[layer - 1] = offset;
+        layout.indexBetweenStart[layer - 1] = offset + staticBetweenSize(layout, layer, n);
+        offset = layout.indexBetweenStart[layer - 1] + staticBetweenSize(layout, layer, layout.indexSize);
+    }
+    layout.bufferSize = offset;
+    return layout;
+}
+
+template<typename T, typename Op = StaticSumOp<T>, int N = 1, bool External = false>
+class StaticSqrtTree {
+    static_assert(N > 0, "StaticSqrtTree needs at least one element");
+
+    public:
+        static constexpr StaticSqrtLayout layout = makeStaticSqrtLayout(N);
+        // number of T elements of the storage, the size of the buffer to pass when External is true
+        static constexpr int bufferSize = layout.bufferSize;
+
+    private:
+        using Buffer = typename conditional<External, T *, array<T, bufferSize>>::type;
+        Buffer buf;
+
+        constexpr T &arrAt(int i) { return buf[i]; }
+        constexpr T &prefixAt(int layer, int i) { return buf[layout.prefixStart + layer * layout.arrSize + i]; }
+        constexpr T &suffixAt(int layer, int i) { return buf[layout.suffixStart + layer * layout.arrSize + i]; }
+        constexpr const T &arrAt(int i) const { return buf[i]; }
+        constexpr const T &prefixAt(int layer, int i) const { return buf[layout.prefixStart + layer * layout.arrSize + i]; }
+        constexpr const T &suffixAt(int layer, int i) const { return buf[layout.suffixStart + layer * layout.arrSize + i]; }
+
+        // position in the buffer of the between answer for the child blocks [i...j] of the block that begins at lBound,
+        // only layers >= 1 have a between (the callers check layout.layerCount > 1 first)
+        static constexpr int betweenIndex(int layer, int base, int lBound, int i, int j) {
+            int block = (lBound - base) >> layout.layers[layer];
+            int start = base == 0 ? layout.betweenStart[layer - 1] : layout.indexBetweenStart[layer - 1];
+            return start + block * layout.triangleSize[layer] + (i << (layout.layers[layer] >> 1)) - ((i * (i - 1)) >> 1) + (j - i);
+        }
+
+        constexpr void buildBlock(int layer, int l, int r) {
+            Op op{};
+            prefixAt(layer, l) = arrAt(l);
+            for (int i = l + 1; i < r; i++) {
+                prefixAt(layer, i) = op(prefixAt(layer, i - 1), arrAt(i));
+            }
+            suffixAt(layer, r - 1) = arrAt(r - 1);
+            for (int i = r - 2; i >= l; i--) {
+                suffixAt(layer, i) = op(arrAt(i), suffixAt(layer, i + 1));
+            }
+        }
+
+        constexpr void buildBetweenZero() {
+            constexpr int childBlockSizeLog = (layout.ceilLog + 1) >> 1;
+            for (int i = 0; i < layout.indexSize; i++) {
+                arrAt(N + i) = suffixAt(0, i << childBlockSizeLog);
+            }
+            build(1, N, N + layout.indexSize, N);
+        }
+
+        constexpr void buildBetween(int layer, int lBound, int rBound, int base) {
+            if constexpr (layout.layerCount < 2) {
+                return;
+            }
+            Op op{};
+            int childBlockSizeLog = (layout.layers[layer] + 1) >> 1;
+            int childBlocksCount = (rBound - lBound + (1 << childBlockSizeLog) - 1) >> childBlockSizeLog;
+            for (int i = 0; i < childBlocksCount; i++) {
+                int row = betweenIndex(layer, base, lBound, i, i);
+                T answer = suffixAt(layer, lBound + (i << childBlockSizeLog));
+                buf[row] = answer;
+                for (int j = i + 1; j < childBlocksCount; j++) {
+                    answer = op(answer, suffixAt(layer, lBound + (j << childBlockSizeLog)));
+                    buf[row + j - i] = answer;
+                }
+            }
+        }
+
+        constexpr void build(int layer, int lBound, int rBound, int base) {
+            if (layer >= layout.layerCount) {
+                return;
+            }
+            int childBlockSize = 1 << ((layout.layers[layer] + 1) >> 1);
+            for (int l = lBound; l < rBound; l += childBlockSize) {
+                int r = l + childBlockSize < rBound ? l + childBlockSize : rBound;
+                buildBlock(layer, l, r);
+                build(layer + 1, l, r, base);
+            }
+            if (layer == 0) {
+                buildBetweenZero();
+            } else {
+                buildBetween(layer, lBound, rBound, base);
+            }
+        }
+
+        constexpr void update(int layer, int lBound, int rBound, int base, int x) {
+            if (layer >= layout.layerCount) {
+                return;
+            }
+            int bSzLog = (layout.layers[layer] + 1) >> 1;
+            int blockIdx = (x - lBound) >> bSzLog;
+            int l = lBound + (blockIdx << bSzLog);
+            int r = l + (1 << bSzLog) < rBound ? l + (1 << bSzLog) : rBound;
+            buildBlock(layer, l, r);
+            if (layer == 0) {
+                constexpr int childBlockSizeLog = (layout.ceilLog + 1) >> 1;
+                arrAt(N + blockIdx) = suffixAt(0, blockIdx << childBlockSizeLog);
+                update(1, N, N + layout.indexSize, N, N + blockIdx);
+            } else {
+                buildBetween(layer, lBound, rBound, base);
+            }
+            update(layer + 1, l, r, base, x);
+        }
+
+        constexpr T query(int l, int r, int base) const {
+            Op op{};
+            if (l == r) {
+                return arrAt(l);
+            } else if (l + 1 == r) {
+                return op(arrAt(l), arrAt(r));
+            }
+            int layer = layout.onLayer[staticHighestBit((unsigned) ((l - base) ^ (r - base)))];
+            int layerLog = layout.layers[layer];
+            int childBlockSizeLog = (layerLog + 1) >> 1;
+            int lBound = (((l - base) >> layerLog) << layerLog) + base;
+            int lBlock = ((l - lBound) >> childBlockSizeLog) + 1;
+            int rBlock = ((r - lBound) >> childBlockSizeLog) - 1;
+            T answer = suffixAt(layer, l);
+            if (lBlock <= rBlock) {
+                T add{};
+                if constexpr (layout.layerCount > 1) {
+                    add = layer == 0 ? query(N + lBlock, N + rBlock, N) : buf[betweenIndex(layer, base, lBound, lBlock, rBlock)];
+                } else {
+                    add = query(N + lBlock, N + rBlock, N);
+                }
+                answer = op(answer, add);
+            }
+            return op(answer, prefixAt(layer, r));
+        }
+
+        constexpr void init(const T *a) {
+            for (int i = 0; i < N; i++) {
+                arrAt(i) = a[i];
+            }
+            build(0, 0, N, 0);
+        }
+
+    public:
+        // build from the N elements of a, all the storage is inside the tree
+        template<bool E = External, typename enable_if<!E, int>::type = 0>
+        constexpr StaticSqrtTree(const T *a) : buf{} {
+            init(a);
+        }
+
+        template<bool E = External, typename enable_if<!E, int>::type = 0>
+        constexpr StaticSqrtTree(const array<T, N> &a) : buf{} {
+            init(a.data());
+        }
+
+        // build from the N elements of a into a caller-provided buffer of bufferSize elements
+        template<bool E = External, typename enable_if<E, int>::type = 0>
+        StaticSqrtTree(T *buffer, const T *a) : buf(buffer) {
+            init(a);
+        }
+
+        constexpr T query(int l, int r) const {
+            return query(l, r, 0);
+        }
+
+        constexpr void update(int idx, const T &val) {
+            arrAt(idx) = val;
+            update(0, 0, N, 0, idx);
+        }
+
+        static constexpr int size() {
+            return N;
+        }
+};
+
+#endif
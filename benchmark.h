@@ -5,13 +5,33 @@
 #include "SqrtTree.h"
 #include "SegmentTree.h"
 #include "FenwickTree.h"
+#include "PersistentSqrtTree.h"
+#include "ConcurrentFenwickTree.h"
+#include "ShardedSqrtTree.h"
+#include "HugePageAllocator.h"
+#include "MultiSqrtTree.h"
+#include "ArgSqrtTree.h"
+#include "SparseTable.h"
+#include "StaticSqrtTree.h"
+#include "CompactSqrtTree.h"
+#include "BlockedFenwickTree.h"
+#include "WideSegmentTree.h"
+#include "InterleavedExecutor.h"
+#include "RangeEngine.h"
+#include "AsyncSqrtTree.h"
 #include <cstdlib>
 #include <chrono>
 #include <fstream>
 #include <iomanip>
 #include <string>
 #include <ctime>
+#include <functional>
+#include <charconv>
 #include <random>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <shared_mutex>
 
 #define ll long long
 
@@ -44,11 +64,24 @@ enum RangePattern {
     RANDOM_RANGE = 0, // Random query ranges
     SMALL_RANGES = 1, // Short query ranges
     LARGE_RANGES = 2, // Long query ranges
-    FIXED_LENGTH = 3 // Query ranges of fixed length
+    FIXED_LENGTH = 3, // Query ranges of fixed length
+    ZIPF_RANGES = 4, // Short ranges starting at Zipf-distributed positions
+    HOTSPOT_RANGES = 5, // Short ranges starting mostly inside one hot region
+    SEQUENTIAL_RANGES = 6, // Short ranges sweeping the array from left to right
+    BURST_RANGES = 7 // Short ranges, each burst of ops stays inside one block
+};
+
+// How a position (update index or start of a query range) is picked
+enum AccessPattern {
+    UNIFORM_ACCESS = 0, // Uniformly random position
+    ZIPF_ACCESS = 1, // Zipf-distributed ranks, scattered over the array
+    HOTSPOT_ACCESS = 2, // hotProb of the accesses go to a hot region of hotFraction * n elements
+    SEQUENTIAL_ACCESS = 3, // The i-th op accesses (i * sweepStep) % n
+    BURST_ACCESS = 4 // Ops come in bursts of burstLen, all positions of a burst fall in one block of burstWidth
 };
 
 struct TestConfig {
-    int n; // Array size
+    ll n; // Array size, may exceed 2^31 - 1 (the trees then need a 64-bit Index)
     int q; // Number of queries
     double ratio; // Update query ratio
     int	minVal; // Minimum value in the array
@@ -56,6 +89,14 @@ struct TestConfig {
     ArrayPattern arrPat; // Array generation pattern
     RangePattern rangePat; // Query range pattern
     int fixLength; // Fixed length for query range (if using FIXED_LENGTH)
+    unsigned long long seed; // Seed of the random streams, the same seed gives the same test file
+    AccessPattern updatePat = UNIFORM_ACCESS; // Update index pattern
+    double zipfS = 0.99; // Zipf exponent (ZIPF_*)
+    double hotFraction = 0.01; // Size of the hot region relative to n (HOTSPOT_*)
+    double hotProb = 0.9; // Probability that an access hits the hot region (HOTSPOT_*)
+    int sweepStep = 1; // Distance between two consecutive ops (SEQUENTIAL_*)
+    int burstLen = 64; // Ops per burst (BURST_*)
+    int burstWidth = 0; // Block width of a burst, 0 means sqrt(n) (BURST_*)
 };
 
 struct BenchmarkResult {
@@ -67,9 +108,11 @@ struct BenchmarkResult {
     int numQueries; // Number of queries
     double avgUpdateTime; // Average update time (μs)
     double avgQueryTime; // Average query time (μs)
+    ll memoryBytes; // Memory used by the structure after the build (bytes, 0 if not reported)
+    string note; // Extra details printed under the results
 
     BenchmarkResult(const string& name) : buildTime(0), totalUpdateTime(0), totalQueryTime(0),
-        numUpdates(0), numQueries(0), avgUpdateTime(0), avgQueryTime(0), dataStructureName(name) {
+        numUpdates(0), numQueries(0), avgUpdateTime(0), avgQueryTime(0), memoryBytes(0), dataStructureName(name) {
     }
 
     void calculateAverages() {
@@ -78,128 +121,243 @@ struct BenchmarkResult {
     }
 };
 
-// General partition function with comparator
-template<typename Compare>
-int partition(vector<int>& arr, int low, int high, Compare comp) {
-    int pivot = arr[high]; // Choose the last element as pivot
-    int i = low - 1; // Index of smaller element
+// Counter-based random numbers: the k-th number of stream s is a pure function of (seed, s, k),
+// so every chunk of a test case can be generated on any thread and in any order, and the same
+// seed always gives a bit-identical test file whatever the number of threads.
+class CounterRng {
+private:
+    unsigned long long key;
+    unsigned long long counter;
+
+    // SplitMix64 finalizer
+    static unsigned long long mix(unsigned long long x) {
+        x += 0x9E3779B97F4A7C15ULL;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+        return x ^ (x >> 31);
+    }
+
+public:
+    CounterRng(unsigned long long seed, unsigned long long stream) : key(mix(seed ^ mix(stream))), counter(0) {}
+
+    unsigned long long next() {
+        return mix(key + counter++ * 0x9E3779B97F4A7C15ULL);
+    }
+
+    // Random integer in range [minVal, maxVal]
+    int nextInt(int minVal, int maxVal) {
+        unsigned long long range = (unsigned long long)((ll)maxVal - minVal) + 1;
+        return (int)(minVal + (ll)(((next() >> 32) * range) >> 32));
+    }
 
-    for (int j = low; j < high; j++) {
-        // If current element satisfies comparator with pivot
-        if (comp(arr[j], pivot)) {
-            i++;
-            swap(arr[i], arr[j]);
+    // Random position in range [minVal, maxVal], the same numbers as nextInt while the range fits in 32 bits
+    ll nextIndex(ll minVal, ll maxVal) {
+        unsigned long long range = (unsigned long long)(maxVal - minVal) + 1;
+        if (range <= (1ULL << 32)) {
+            return minVal + (ll)(((next() >> 32) * range) >> 32);
         }
+        return minVal + (ll)(((unsigned __int128)next() * range) >> 64);
     }
 
-    swap(arr[i + 1], arr[high]);
-    return i + 1;
-}
+    // Random double in range [0.0, 1.0)
+    double nextDouble() {
+        return (next() >> 11) * (1.0 / 9007199254740992.0);
+    }
+};
+
+// Independent stream families of a test case
+enum RngStream {
+    ARRAY_STREAM = 1,
+    OPS_STREAM = 2,
+    HOT_STREAM = 3,
+    BURST_STREAM = 4
+};
 
-// General quickSort function with comparator
-template<typename Compare>
-void quickSort(vector<int>& arr, int low, int high, Compare comp) {
-    if (low < high) {
-        int pi = partition(arr, low, high, comp);
+// Elements (or ops) per generation chunk, each chunk draws from its own stream
+const int GEN_CHUNK = 1 << 16;
 
-        quickSort(arr, low, pi - 1, comp);
-        quickSort(arr, pi + 1, high, comp);
+// Run work(chunk) for every chunk in [0, chunks) on all hardware threads
+template<typename Work>
+void parallelChunks(int chunks, Work work) {
+    int threads = (int)min<unsigned>(max(1u, thread::hardware_concurrency()), (unsigned)max(1, chunks));
+    atomic<int> nextChunk(0);
+    vector<thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&]() {
+            for (int c = nextChunk.fetch_add(1); c < chunks; c = nextChunk.fetch_add(1)) {
+                work(c);
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
     }
 }
 
-// Wrapper function for ascending sort
-void quickSortASC(vector<int>& arr, int left, int right) {
-    quickSort(arr, left, right, [](int a, int b) { return a <= b; });
-}
+// Generator used by the benchmarks that do not go through a test file
+static mt19937 gen(random_device{}());
 
-// Wrapper function for descending sort
-void quickSortDESC(vector<int>& arr, int left, int right) {
-    quickSort(arr, left, right, [](int a, int b) { return a >= b; });
+void seedRandom(unsigned long long seed) {
+    gen.seed((unsigned)(seed ^ (seed >> 32)));
 }
 
 // Generate random integer in range [minVal, maxVal]
-static mt19937 gen(random_device{}());
 int randomInt(int minVal, int maxVal) {
     uniform_int_distribution<> dis(minVal, maxVal);
     return dis(gen);
 }
 
-// Generate random double in range [0.0, 1.0]
-double randomDouble() {
-    uniform_real_distribution<> dis(0.0, 1.0);
-    return dis(gen);
-}
-
 // Generate array based on config
 vector<int> generateArray(const TestConfig& config) {
     vector<int> arr(config.n);
 
-    switch (config.arrPat) {
-    case RANDOM: {
-        for (int i = 0; i < config.n; i++) {
-            arr[i] = randomInt(config.minVal, config.maxVal);
-        }
-        break;
+    if (config.arrPat == CONSTANT) {
+        int val = CounterRng(config.seed, ARRAY_STREAM).nextInt(config.minVal, config.maxVal);
+        fill(arr.begin(), arr.end(), val);
+        return arr;
     }
-    case ASC: {
-        for (int i = 0; i < config.n; i++) {
-            arr[i] = randomInt(config.minVal, config.maxVal);
+
+    int chunks = (int)((config.n + GEN_CHUNK - 1) / GEN_CHUNK);
+    parallelChunks(chunks, [&](int c) {
+        CounterRng rng(config.seed, ((unsigned long long)ARRAY_STREAM << 32) | (unsigned)c);
+        ll end = min(config.n, (ll)(c + 1) * GEN_CHUNK);
+        for (ll i = (ll)c * GEN_CHUNK; i < end; i++) {
+            arr[i] = rng.nextInt(config.minVal, config.maxVal);
         }
-        quickSortASC(arr, 0, config.n - 1);
-        break;
+    });
+
+    if (config.arrPat == ASC) {
+        sort(arr.begin(), arr.end());
     }
-    case DESC: {
-        for (int i = 0; i < config.n; i++) {
-            arr[i] = randomInt(config.minVal, config.maxVal);
-        }
-        quickSortDESC(arr, 0, config.n - 1);
-        break;
+    else if (config.arrPat == DESC) {
+        sort(arr.begin(), arr.end(), greater<int>());
+    }
+
+    return arr;
+}
+
+// Zipf(s) sampler over ranks [1, n] by rejection-inversion (Hormann and Derflinger),
+// O(1) expected time per sample and no table, so it works for any n
+class ZipfSampler {
+private:
+    ll n;
+    double s, hIntegralX1, hIntegralN, threshold;
+
+    // log1p(x) / x and expm1(x) / x, continuous at 0
+    static double helper1(double x) {
+        return fabs(x) > 1e-8 ? log1p(x) / x : 1 - x * (0.5 - x * (1.0 / 3 - 0.25 * x));
+    }
+
+    static double helper2(double x) {
+        return fabs(x) > 1e-8 ? expm1(x) / x : 1 + x * 0.5 * (1 + x * (1.0 / 3) * (1 + 0.25 * x));
+    }
+
+    // h(x) = x^-s and its integral H
+    double h(double x) const {
+        return exp(-s * log(x));
     }
-    case CONSTANT: {
-        int val = randomInt(config.minVal, config.maxVal);
-        for (int i = 0; i < config.n; i++) {
-            arr[i] = val;
+
+    double hIntegral(double x) const {
+        double logX = log(x);
+        return helper2((1 - s) * logX) * logX;
+    }
+
+    double hIntegralInverse(double x) const {
+        double t = max(-1.0, x * (1 - s));
+        return exp(helper1(t) * x);
+    }
+
+public:
+    ZipfSampler(ll n, double s) : n(max(1LL, n)), s(s) {
+        hIntegralX1 = hIntegral(1.5) - 1;
+        hIntegralN = hIntegral(this->n + 0.5);
+        threshold = 2 - hIntegralInverse(hIntegral(2.5) - h(2));
+    }
+
+    // Rank in [1, n], rank 1 is the most frequent
+    ll sample(CounterRng& rng) const {
+        while (true) {
+            double u = hIntegralN + rng.nextDouble() * (hIntegralX1 - hIntegralN);
+            double x = hIntegralInverse(u);
+            ll k = (ll)min<double>(n, max(1.0, x + 0.5));
+            if (k - x <= threshold || u >= hIntegral(k + 0.5) - h(k)) {
+                return k;
+            }
         }
-        break;
     }
-    default:
-        break;
+};
+
+// Picks positions according to an AccessPattern. Everything that is shared between ops (hot
+// region, block of a burst) is derived from the seed and the op index only, so chunks of ops can
+// still be generated independently
+class AccessGenerator {
+private:
+    const TestConfig& config;
+    ZipfSampler zipf;
+    ll hotStart, hotSize, burstWidth;
+
+public:
+    AccessGenerator(const TestConfig& config) : config(config), zipf(config.n, config.zipfS) {
+        hotSize = (ll)min<double>(config.n, max(1.0, config.hotFraction * config.n));
+        hotStart = CounterRng(config.seed, HOT_STREAM).nextIndex(0, config.n - hotSize);
+        burstWidth = config.burstWidth > 0 ? min<ll>(config.burstWidth, config.n) : max(1LL, (ll)sqrt((double)config.n));
     }
 
-    return arr;
-}
+    ll pick(AccessPattern pattern, CounterRng& rng, ll opIdx) const {
+        switch (pattern) {
+        case ZIPF_ACCESS: {
+            // scatter the ranks so the hot keys are not all neighbours
+            unsigned long long rank = zipf.sample(rng) - 1;
+            return (ll)(rank * 2654435761ULL % config.n);
+        }
+        case HOTSPOT_ACCESS: {
+            if (rng.nextDouble() < config.hotProb) {
+                return hotStart + rng.nextIndex(0, hotSize - 1);
+            }
+            return rng.nextIndex(0, config.n - 1);
+        }
+        case SEQUENTIAL_ACCESS:
+            return (ll)((unsigned long long)opIdx * config.sweepStep % config.n);
+        case BURST_ACCESS: {
+            ll burst = opIdx / max(1, config.burstLen);
+            ll blocks = (config.n + burstWidth - 1) / burstWidth;
+            ll blockStart = CounterRng(config.seed, ((unsigned long long)BURST_STREAM << 32) | (unsigned long long)burst).nextIndex(0, blocks - 1) * burstWidth;
+            return blockStart + rng.nextIndex(0, min(burstWidth, config.n - blockStart) - 1);
+        }
+        default:
+            return rng.nextIndex(0, config.n - 1);
+        }
+    }
+};
 
 // Generate a pair of indices (l, r) according to the specified pattern
-pair<int, int> generateRange(const TestConfig& config, int queryIdx = -1) {
-    int l, r;
+pair<ll, ll> generateRange(const TestConfig& config, CounterRng& rng, const AccessGenerator& access, ll opIdx) {
+    ll l = 0, r = 0;
     switch (config.rangePat)
     {
     case RANDOM_RANGE: {
-        l = randomInt(0, config.n - 1);
-        r = randomInt(0, config.n - 1);
+        l = rng.nextIndex(0, config.n - 1);
+        r = rng.nextIndex(0, config.n - 1);
         if (l > r) {
             swap(l, r);
         }
         break;
     }
     case SMALL_RANGES: {
-        l = randomInt(0, config.n - 1);
-        int maxRange = max(1, config.n / 20);
-        r = min(config.n - 1, l + randomInt(0, maxRange));
+        l = rng.nextIndex(0, config.n - 1);
+        ll maxRange = max(1LL, config.n / 20);
+        r = min(config.n - 1, l + rng.nextIndex(0, maxRange));
         break;
     }
     case LARGE_RANGES: {
-        l = randomInt(0, config.n - 1);
-        int minRange = config.n / 2;
-        r = min(config.n - 1, l + randomInt(minRange, config.n - 1));
-        if (r >= config.n) {
-            r = config.n - 1;
-        }
+        l = rng.nextIndex(0, config.n - 1);
+        ll minRange = config.n / 2;
+        r = min(config.n - 1, l + rng.nextIndex(minRange, config.n - 1));
         break;
     }
     case FIXED_LENGTH: {
         int length = config.fixLength; // Use fixed length (if specified)
-        l = randomInt(0, config.n - length); // Ensure there is enough space for a segment
+        l = rng.nextIndex(0, config.n - length); // Ensure there is enough space for a segment
         r = l + length - 1;
         // If r exceeds array size
         if (r >= config.n) {
@@ -207,6 +365,19 @@ pair<int, int> generateRange(const TestConfig& config, int queryIdx = -1) {
         }
         break;
     }
+    case ZIPF_RANGES:
+    case HOTSPOT_RANGES:
+    case SEQUENTIAL_RANGES:
+    case BURST_RANGES: {
+        // start picked by the access pattern, length like SMALL_RANGES
+        AccessPattern pattern = config.rangePat == ZIPF_RANGES ? ZIPF_ACCESS
+            : config.rangePat == HOTSPOT_RANGES ? HOTSPOT_ACCESS
+            : config.rangePat == SEQUENTIAL_RANGES ? SEQUENTIAL_ACCESS : BURST_ACCESS;
+        l = access.pick(pattern, rng, opIdx);
+        ll maxRange = max(1LL, config.n / 20);
+        r = min(config.n - 1, l + rng.nextIndex(0, maxRange));
+        break;
+    }
     default:
         break;
     }
@@ -214,36 +385,71 @@ pair<int, int> generateRange(const TestConfig& config, int queryIdx = -1) {
     return { l, r };
 }
 
+// Append a number and a separator to a text buffer
+void appendInt(string& out, ll value, char sep) {
+    char buf[24];
+    char* end = to_chars(buf, buf + sizeof(buf), value).ptr;
+    out.append(buf, end - buf);
+    out.push_back(sep);
+}
+
 // Generate test case according to config
+// The array and the ops are generated and formatted chunk by chunk on all threads, a few chunks
+// per thread at a time so the text of a big case never has to sit in memory as a whole
 void generateTest(const string& filename, const TestConfig& config) {
-    ofstream out(filename);
+    ofstream out(filename, ios::binary);
     if (!out.is_open()) {
         std::cerr << "Cannot open file " << filename << " for writing" << endl;
         return;
     }
 
-    srand(time(0));
     out << config.n << " " << config.q << "\n";
 
+    int wave = 4 * (int)max(1u, thread::hardware_concurrency());
+    vector<string> text(wave);
+
     vector<int> arr = generateArray(config);
-    for (int i = 0; i < config.n; i++) {
-        out << arr[i] << (i < config.n - 1 ? " " : "\n");
+    AccessGenerator access(config);
+    int chunks = (int)((config.n + GEN_CHUNK - 1) / GEN_CHUNK);
+    for (int first = 0; first < chunks; first += wave) {
+        int count = min(wave, chunks - first);
+        parallelChunks(count, [&](int w) {
+            int c = first + w;
+            text[w].clear();
+            ll end = min(config.n, (ll)(c + 1) * GEN_CHUNK);
+            for (ll i = (ll)c * GEN_CHUNK; i < end; i++) {
+                appendInt(text[w], arr[i], i < config.n - 1 ? ' ' : '\n');
+            }
+        });
+        for (int w = 0; w < count; w++) {
+            out.write(text[w].data(), text[w].size());
+        }
     }
 
-    int updateQueries = 0;
-    for (int i = 0; i < config.q; i++) {
-        bool isUpdate = (randomDouble() < config.ratio);
-
-        if (isUpdate && updateQueries < config.q) {
-            int idx = randomInt(0, config.n - 1);
-            int val = randomInt(config.minVal, config.maxVal);
-
-            out << "1 " << idx << " " << val << "\n";
-            updateQueries++;
-        }
-        else {
-            auto [l, r] = generateRange(config, i);
-            out << "0 " << l << " " << r << "\n";
+    chunks = (config.q + GEN_CHUNK - 1) / GEN_CHUNK;
+    for (int first = 0; first < chunks; first += wave) {
+        int count = min(wave, chunks - first);
+        parallelChunks(count, [&](int w) {
+            int c = first + w;
+            CounterRng rng(config.seed, ((unsigned long long)OPS_STREAM << 32) | (unsigned)c);
+            text[w].clear();
+            int end = min(config.q, (c + 1) * GEN_CHUNK);
+            for (int i = c * GEN_CHUNK; i < end; i++) {
+                if (rng.nextDouble() < config.ratio) {
+                    text[w] += "1 ";
+                    appendInt(text[w], access.pick(config.updatePat, rng, i), ' ');
+                    appendInt(text[w], rng.nextInt(config.minVal, config.maxVal), '\n');
+                }
+                else {
+                    auto [l, r] = generateRange(config, rng, access, i);
+                    text[w] += "0 ";
+                    appendInt(text[w], l, ' ');
+                    appendInt(text[w], r, '\n');
+                }
+            }
+        });
+        for (int w = 0; w < count; w++) {
+            out.write(text[w].data(), text[w].size());
         }
     }
 
@@ -252,6 +458,62 @@ void generateTest(const string& filename, const TestConfig& config) {
     cout << "- Array size: " << config.n << endl;
     cout << "- Number of queries: " << config.q << endl;
     cout << "- Update ratio: " << config.ratio * 100 << "%" << endl;
+    cout << "- Seed: " << config.seed << endl;
+}
+
+// StaticSqrtTree needs its size at compile time, so it cannot be benchmarked on a test file:
+// instead a few sizes (no layer, one layer, one and two between layers) are built, updated and queried at compile time
+template<int N>
+constexpr bool staticSqrtTreeMatches() {
+    array<int, N> a{};
+    for (int i = 0; i < N; i++) {
+        a[i] = i * 7 % 5 + 1;
+    }
+    StaticSqrtTree<int, StaticSumOp<int>, N> tree(a);
+    tree.update(N / 2, 100);
+    a[N / 2] = 100;
+    for (int l = 0; l < N; l++) {
+        int sum = 0;
+        for (int r = l; r < N; r++) {
+            sum += a[r];
+            if (tree.query(l, r) != sum) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+static_assert(staticSqrtTreeMatches<1>() && staticSqrtTreeMatches<3>() && staticSqrtTreeMatches<5>()
+    && staticSqrtTreeMatches<40>(), "StaticSqrtTree answers differ from a direct sum");
+
+// Memory used by a structure, 0 for the structures that do not report it
+template<typename TreeType>
+ll treeMemoryUsage(const TreeType&) { return 0; }
+template<typename Allocator, typename Index, typename Storage>
+ll treeMemoryUsage(const BasicSqrtTree<Allocator, Index, Storage>& tree) { return tree.memoryUsage(); }
+ll treeMemoryUsage(const PersistentSqrtTree& tree) { return tree.memoryUsage(); }
+template<typename Delta>
+ll treeMemoryUsage(const CompactSqrtTree<Delta>& tree) { return tree.memoryUsage(); }
+template<typename Allocator, typename Index>
+ll treeMemoryUsage(const BasicSegmentTree<Allocator, Index>& tree) { return tree.memoryUsage(); }
+template<typename Allocator, typename Index>
+ll treeMemoryUsage(const BasicFenwickTree<Allocator, Index>& tree) { return tree.memoryUsage(); }
+ll treeMemoryUsage(const BlockedFenwickTree& tree) { return tree.memoryUsage(); }
+ll treeMemoryUsage(const WideSegmentTree& tree) { return tree.memoryUsage(); }
+ll treeMemoryUsage(const RangeEngine& tree) { return tree.memoryUsage(); }
+
+// Extra memory details of a structure
+template<typename TreeType>
+string treeMemoryNote(const TreeType&) { return ""; }
+template<typename Allocator, typename Index>
+string treeMemoryNote(const BasicSqrtTree<Allocator, Index>& tree) {
+    return "between: " + to_string(tree.betweenMemoryUsage() / 1024) + " KB packed triangles, "
+        + to_string(tree.squareBetweenMemoryUsage() / 1024) + " KB as full squares";
+}
+template<typename Delta>
+string treeMemoryNote(const CompactSqrtTree<Delta>& tree) {
+    return to_string(tree.compactBlockCount()) + " of " + to_string(tree.blockCount()) + " child blocks stored as "
+        + to_string(8 * sizeof(Delta)) + "-bit deltas";
 }
 
 template<typename TreeType, typename UpdateFunc, typename QueryFunc>
@@ -263,20 +525,24 @@ BenchmarkResult benchmarkTree(const string& filename, const string& name, Update
         return result;
     }
 
-    int n, q;
+    ll n;
+    int q;
     in >> n >> q;
     vector<int> arr(n);
-    for (int i = 0; i < n; ++i) {
+    for (ll i = 0; i < n; ++i) {
         in >> arr[i];
     }
 
     Timer buildTimer;
     TreeType tree(arr);
     result.buildTime = buildTimer.Stop();
+    result.memoryBytes = treeMemoryUsage(tree);
+    result.note = treeMemoryNote(tree);
 
     Timer queryTimer; // Timer for all queries
     for (int i = 0; i < q; ++i) {
-        int type, x, y;
+        int type;
+        ll x, y;
         in >> type >> x >> y;
         if (type == 1) {
             Timer timer;
@@ -295,10 +561,39 @@ BenchmarkResult benchmarkTree(const string& filename, const string& name, Update
     return result;
 }
 // Run all benchmarks and compare
-vector<BenchmarkResult> runAllBenchmarks(const string& filename) {
+// With hugePages the three main structures are benchmarked a second time with their arrays in a HugePageArena
+vector<BenchmarkResult> runAllBenchmarks(const string& filename, bool hugePages = false) {
     vector<BenchmarkResult> results;
     cout << "Running benchmark for file: " << filename << "\n=======================================\n";
 
+    // past 2^31 - 1 elements only the structures with a 64-bit index can hold the array
+    ll n = 0;
+    ifstream header(filename);
+    header >> n;
+    header.close();
+    if (n > INT_MAX) {
+        cout << "n = " << n << " needs 64-bit indices, only the 64-bit trees are benchmarked\n";
+        cout << "Benchmark SqrtTree64...\n";
+        results.push_back(benchmarkTree<SqrtTree64>(
+            filename, "SqrtTree64",
+            [](SqrtTree64& tree, ll idx, int val) { tree.update(idx, val); },
+            [](SqrtTree64& tree, ll l, ll r) { return tree.query(l, r); }
+        ));
+        cout << "Benchmark SegmentTree64...\n";
+        results.push_back(benchmarkTree<SegmentTree64>(
+            filename, "SegmentTree64",
+            [](SegmentTree64& tree, ll idx, int val) { tree.set(idx, val); },
+            [](SegmentTree64& tree, ll l, ll r) { return tree.query(l, r); }
+        ));
+        cout << "Benchmark FenwickTree64...\n";
+        results.push_back(benchmarkTree<FenwickTree64>(
+            filename, "FenwickTree64",
+            [](FenwickTree64& tree, ll idx, int val) { tree.set(idx, val); },
+            [](FenwickTree64& tree, ll l, ll r) { return tree.query(l, r); }
+        ));
+        return results;
+    }
+
     cout << "Benchmark SqrtTree...\n";
     results.push_back(benchmarkTree<SqrtTree>(
         filename, "SqrtTree",
@@ -306,6 +601,43 @@ vector<BenchmarkResult> runAllBenchmarks(const string& filename) {
         [](SqrtTree& tree, int l, int r) { return tree.query(l, r); }
     ));
 
+    // every update derives a new version from the latest one, only the last two are retained
+    cout << "Benchmark PersistentSqrtTree...\n";
+    results.push_back(benchmarkTree<PersistentSqrtTree>(
+        filename, "PersistentSqrt",
+        [](PersistentSqrtTree& tree, int idx, int val) { tree.update(tree.latest(), idx, val); tree.retainLast(2); },
+        [](PersistentSqrtTree& tree, int l, int r) { return tree.query(tree.latest(), l, r); }
+    ));
+
+    // prefix/suffix as 16-bit deltas on the layers whose blocks fit, the others stay full width
+    cout << "Benchmark CompactSqrtTree...\n";
+    results.push_back(benchmarkTree<CompactSqrtTree<>>(
+        filename, "CompactSqrt",
+        [](CompactSqrtTree<>& tree, int idx, int val) { tree.update(idx, val); },
+        [](CompactSqrtTree<>& tree, int l, int r) { return tree.query(l, r); }
+    ));
+
+    // sum, min and max of every range in one query, the two memory layouts of the aggregates
+    cout << "Benchmark MultiSqrtTree...\n";
+    results.push_back(benchmarkTree<MultiSqrtTree<AOS_LAYOUT>>(
+        filename, "MultiSqrt(AoS)",
+        [](MultiSqrtTree<AOS_LAYOUT>& tree, int idx, int val) { tree.update(idx, val); },
+        [](MultiSqrtTree<AOS_LAYOUT>& tree, int l, int r) { return tree.query(l, r); }
+    ));
+    results.push_back(benchmarkTree<MultiSqrtTree<SOA_LAYOUT>>(
+        filename, "MultiSqrt(SoA)",
+        [](MultiSqrtTree<SOA_LAYOUT>& tree, int idx, int val) { tree.update(idx, val); },
+        [](MultiSqrtTree<SOA_LAYOUT>& tree, int l, int r) { return tree.query(l, r); }
+    ));
+
+    // one shard per hardware thread, single-threaded here so this shows the cost of the shard locks and index
+    cout << "Benchmark ShardedSqrtTree...\n";
+    results.push_back(benchmarkTree<ShardedSqrtTree>(
+        filename, "ShardedSqrt",
+        [](ShardedSqrtTree& tree, int idx, int val) { tree.update(idx, val); },
+        [](ShardedSqrtTree& tree, int l, int r) { return tree.query(l, r); }
+    ));
+
     cout << "Benchmark SegmentTree...\n";
     results.push_back(benchmarkTree<SegmentTree>(
         filename, "SegmentTree",
@@ -313,6 +645,14 @@ vector<BenchmarkResult> runAllBenchmarks(const string& filename) {
         [](SegmentTree& tree, int l, int r) { return tree.query(l, r); }
     ));
 
+    // fanout 16, one cache line per level
+    cout << "Benchmark WideSegmentTree...\n";
+    results.push_back(benchmarkTree<WideSegmentTree>(
+        filename, "WideSegTree",
+        [](WideSegmentTree& tree, int idx, int val) { tree.set(idx, val); },
+        [](WideSegmentTree& tree, int l, int r) { return tree.query(l, r); }
+    ));
+
     cout << "Benchmark FenwickTree...\n";
     results.push_back(benchmarkTree<FenwickTree>(
         filename, "FenwickTree",
@@ -320,6 +660,54 @@ vector<BenchmarkResult> runAllBenchmarks(const string& filename) {
         [](FenwickTree& tree, int l, int r) { return tree.query(l, r); }
     ));
 
+    cout << "Benchmark BlockedFenwickTree...\n";
+    results.push_back(benchmarkTree<BlockedFenwickTree>(
+        filename, "BlockedFenwick",
+        [](BlockedFenwickTree& tree, int idx, int val) { tree.set(idx, val); },
+        [](BlockedFenwickTree& tree, int l, int r) { return tree.query(l, r); }
+    ));
+
+    // starts on SqrtTree and moves to the backend the cost model picks for the file's mix
+    cout << "Benchmark RangeEngine...\n";
+    results.push_back(benchmarkTree<RangeEngine>(
+        filename, "RangeEngine",
+        [](RangeEngine& tree, int idx, int val) { tree.update(idx, val); },
+        [](RangeEngine& tree, int l, int r) { return tree.query(l, r); }
+    ));
+
+    if (hugePages) {
+        typedef BasicSqrtTree<HugePageAllocator<SqrtTreeItem>> HugeSqrtTree;
+        typedef BasicSegmentTree<HugePageAllocator<int>> HugeSegmentTree;
+        typedef BasicFenwickTree<HugePageAllocator<int>> HugeFenwickTree;
+
+        cout << "Benchmark SqrtTree on huge pages...\n";
+        results.push_back(benchmarkTree<HugeSqrtTree>(
+            filename, "SqrtTree+HP",
+            [](HugeSqrtTree& tree, int idx, int val) { tree.update(idx, val); },
+            [](HugeSqrtTree& tree, int l, int r) { return tree.query(l, r); }
+        ));
+
+        cout << "Benchmark SegmentTree on huge pages...\n";
+        results.push_back(benchmarkTree<HugeSegmentTree>(
+            filename, "SegmentTree+HP",
+            [](HugeSegmentTree& tree, int idx, int val) { tree.set(idx, val); },
+            [](HugeSegmentTree& tree, int l, int r) { return tree.query(l, r); }
+        ));
+
+        cout << "Benchmark FenwickTree on huge pages...\n";
+        results.push_back(benchmarkTree<HugeFenwickTree>(
+            filename, "FenwickTree+HP",
+            [](HugeFenwickTree& tree, int idx, int val) { tree.set(idx, val); },
+            [](HugeFenwickTree& tree, int l, int r) { return tree.query(l, r); }
+        ));
+
+        HugePageArena& arena = HugePageArena::defaultArena(HugePageArena::preferHugeTlb());
+        if (arena.fallbackRegionCount() > 0) {
+            cout << "MAP_HUGETLB failed for " << arena.fallbackRegionCount()
+                << " region(s), they used transparent huge pages instead\n";
+        }
+    }
+
     return results;
 }
 
@@ -333,8 +721,9 @@ void printBenchmarkResults(const vector<BenchmarkResult>& results) {
         << setw(12) << "Queries"
         << setw(15) << "Avg Query(us)"
         << setw(15) << "Total Update(us)"
-        << setw(15) << "Total Query(us)" << endl;
-    cout << string(110, '-') << endl;
+        << setw(15) << "Total Query(us)"
+        << setw(12) << "Memory(KB)" << endl;
+    cout << string(122, '-') << endl;
 
     for (const auto& result : results) {
         cout << left << setw(15) << result.dataStructureName
@@ -344,7 +733,13 @@ void printBenchmarkResults(const vector<BenchmarkResult>& results) {
             << setw(12) << result.numQueries
             << setw(15) << fixed << setprecision(2) << result.avgQueryTime
             << setw(15) << result.totalUpdateTime
-            << setw(15) << result.totalQueryTime << endl;
+            << setw(15) << result.totalQueryTime
+            << setw(12) << (result.memoryBytes > 0 ? to_string(result.memoryBytes / 1024) : "-") << endl;
+    }
+    for (const auto& result : results) {
+        if (!result.note.empty()) {
+            cout << result.dataStructureName << " " << result.note << endl;
+        }
     }
     cout << endl;
 }
@@ -358,7 +753,7 @@ void saveBenchmarkToCSV(const vector<BenchmarkResult>& results, const string& cs
     }
 
     // Header
-    csvFile << "DataStructure;BuildTime(us);NumUpdates;AvgUpdateTime(us);NumQueries;AvgQueryTime(us);TotalUpdateTime(us);TotalQueryTime(us)\n";
+    csvFile << "DataStructure;BuildTime(us);NumUpdates;AvgUpdateTime(us);NumQueries;AvgQueryTime(us);TotalUpdateTime(us);TotalQueryTime(us);Memory(bytes)\n";
     
     // Data collums
     for (const auto& result : results) {
@@ -369,20 +764,953 @@ void saveBenchmarkToCSV(const vector<BenchmarkResult>& results, const string& cs
             << result.numQueries << ";"
             << fixed << setprecision(2) << result.avgQueryTime << ";"
             << result.totalUpdateTime << ";"
-            << result.totalQueryTime << "\n";
+            << result.totalQueryTime << ";"
+            << result.memoryBytes << "\n";
     }
 
     csvFile.close();
     cout << "Saved benchmark results to: " << csvFilename << endl;
 }
 
+// Run `threads` writers, each applying its own list of point increments through add(tree, idx, val)
+// Returns the wall time (us) from the moment all writers are released until the last one finishes
+template<typename AddFunc>
+ll runConcurrentWriters(const vector<vector<pair<int, int>>>& ops, AddFunc add) {
+    atomic<int> ready(0);
+    atomic<bool> go(false);
+    vector<thread> workers;
+    for (size_t t = 0; t < ops.size(); t++) {
+        workers.emplace_back([&, t]() {
+            ready.fetch_add(1);
+            while (!go.load(memory_order_acquire)) {
+                this_thread::yield();
+            }
+            for (const auto& [idx, val] : ops[t]) {
+                add(idx, val);
+            }
+        });
+    }
+    while (ready.load() < (int)ops.size()) {
+        this_thread::yield();
+    }
+    Timer timer;
+    go.store(true, memory_order_release);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    return timer.Stop();
+}
+
+// Counter ingestion benchmark: 1 to maxThreads writers increment random counters of an n-element FenwickTree
+// Compares a mutex-wrapped FenwickTree, the atomic ConcurrentFenwickTree and the striped one (one stripe per writer)
+void runConcurrentFenwickBenchmark(int n, int opsPerThread, int maxThreads = 64) {
+    cout << "\n======= CONCURRENT FENWICK BENCHMARK =======\n";
+    cout << "n = " << n << ", " << opsPerThread << " increments per writer, "
+        << thread::hardware_concurrency() << " hardware threads\n";
+    cout << left << setw(10) << "Writers"
+        << setw(20) << "Mutex(Mops/s)"
+        << setw(20) << "Atomic(Mops/s)"
+        << setw(20) << "Striped(Mops/s)" << endl;
+    cout << string(70, '-') << endl;
+
+    vector<int> zeros(n, 0);
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+        vector<vector<pair<int, int>>> ops(threads);
+        ll expected = 0;
+        for (int t = 0; t < threads; t++) {
+            ops[t].resize(opsPerThread);
+            for (auto& op : ops[t]) {
+                op = { randomInt(0, n - 1), 1 };
+                expected += op.second;
+            }
+        }
+        double totalOps = (double)threads * opsPerThread;
+        auto mops = [&](ll us) { return us > 0 ? totalOps / us : 0.0; };
+
+        FenwickTree locked(zeros);
+        mutex lock;
+        ll mutexTime = runConcurrentWriters(ops, [&](int idx, int val) {
+            lock_guard<mutex> guard(lock);
+            locked.update(idx, val);
+        });
+
+        ConcurrentFenwickTree atomicTree(zeros);
+        ll atomicTime = runConcurrentWriters(ops, [&](int idx, int val) { atomicTree.update(idx, val); });
+
+        ConcurrentFenwickTree stripedTree(zeros, threads);
+        ll stripedTime = runConcurrentWriters(ops, [&](int idx, int val) { stripedTree.update(idx, val); });
+
+        // writers are joined, so every query is exact now
+        if (locked.query(0, n - 1) != expected || atomicTree.query(0, n - 1) != expected
+            || stripedTree.query(0, n - 1) != expected) {
+            cerr << "Concurrent Fenwick mismatch with " << threads << " writers" << endl;
+        }
+
+        cout << left << setw(10) << threads
+            << setw(20) << fixed << setprecision(2) << mops(mutexTime)
+            << setw(20) << fixed << setprecision(2) << mops(atomicTime)
+            << setw(20) << fixed << setprecision(2) << mops(stripedTime) << endl;
+    }
+    cout << endl;
+}
+
+// One reader/writer run: ops done and latency samples (ns) of every reader and writer thread
+struct ReadWriteRun {
+    double seconds = 0;
+    vector<ll> readerOps, writerOps;
+    vector<vector<uint32_t>> readerLatency, writerLatency;
+};
+
+// Readers cycle through their ranges calling query(l, r), writers through their (idx, val) calling update,
+// all at the same time for durationMs; every op is timed, the first RW_SAMPLES of each thread are kept
+const int RW_SAMPLES = 1 << 18;
+
+template<typename QueryFunc, typename UpdateFunc>
+ReadWriteRun runReadersWriters(const vector<vector<pair<int, int>>>& readerOps, const vector<vector<pair<int, int>>>& writerOps,
+    int durationMs, QueryFunc query, UpdateFunc update) {
+    int readers = readerOps.size(), writers = writerOps.size();
+    ReadWriteRun run;
+    run.readerOps.assign(readers, 0);
+    run.writerOps.assign(writers, 0);
+    run.readerLatency.resize(readers);
+    run.writerLatency.resize(writers);
+
+    atomic<int> ready(0);
+    atomic<bool> go(false), stop(false);
+    atomic<ll> sink(0);
+    auto worker = [&](const vector<pair<int, int>>& ops, bool isWriter, ll& done, vector<uint32_t>& latency) {
+        latency.reserve(RW_SAMPLES);
+        ll count = 0, checksum = 0;
+        ready.fetch_add(1);
+        while (!go.load(memory_order_acquire)) {
+            this_thread::yield();
+        }
+        for (size_t i = 0; !stop.load(memory_order_relaxed); i = i + 1 == ops.size() ? 0 : i + 1) {
+            auto start = steady_clock::now();
+            if (isWriter) {
+                update(ops[i].first, ops[i].second);
+            }
+            else {
+                checksum += query(ops[i].first, ops[i].second);
+            }
+            auto ns = duration_cast<nanoseconds>(steady_clock::now() - start).count();
+            if (latency.size() < RW_SAMPLES) {
+                latency.push_back((uint32_t)min<ll>(ns, UINT32_MAX));
+            }
+            count++;
+        }
+        done = count;
+        sink.fetch_add(checksum, memory_order_relaxed);
+    };
+
+    vector<thread> threads;
+    for (int t = 0; t < readers; t++) {
+        threads.emplace_back(worker, cref(readerOps[t]), false, ref(run.readerOps[t]), ref(run.readerLatency[t]));
+    }
+    for (int t = 0; t < writers; t++) {
+        threads.emplace_back(worker, cref(writerOps[t]), true, ref(run.writerOps[t]), ref(run.writerLatency[t]));
+    }
+    while (ready.load() < readers + writers) {
+        this_thread::yield();
+    }
+    auto start = steady_clock::now();
+    go.store(true, memory_order_release);
+    this_thread::sleep_for(milliseconds(durationMs));
+    stop.store(true, memory_order_relaxed);
+    for (auto& t : threads) {
+        t.join();
+    }
+    run.seconds = duration<double>(steady_clock::now() - start).count();
+    return run;
+}
+
+// p-th percentile (0..1) of the samples of all the threads of one role
+double latencyPercentile(const vector<vector<uint32_t>>& perThread, double p) {
+    vector<uint32_t> all;
+    for (const auto& samples : perThread) {
+        all.insert(all.end(), samples.begin(), samples.end());
+    }
+    if (all.empty()) {
+        return 0;
+    }
+    size_t k = min(all.size() - 1, (size_t)(p * all.size()));
+    nth_element(all.begin(), all.begin() + k, all.end());
+    return all[k];
+}
+
+// Highest p99 of one thread of a role, the thread that waited the most
+double worstThreadP99(const vector<vector<uint32_t>>& perThread) {
+    double worst = 0;
+    for (const auto& samples : perThread) {
+        worst = max(worst, latencyPercentile({ samples }, 0.99));
+    }
+    return worst;
+}
+
+// Thread count after which doubling the threads gains less than 10% aggregate throughput, given it for 1, 2, 4, ...
+string scalingLimit(const vector<pair<int, double>>& curve) {
+    for (size_t i = 1; i < curve.size(); i++) {
+        if (curve[i].second < 1.1 * curve[i - 1].second) {
+            return "stops at " + to_string(curve[i - 1].first);
+        }
+    }
+    return "scales up to " + to_string(curve.back().first);
+}
+
+// The grid of 1, 2, 4, ... maxThreads readers times 1, 2, 4, ... maxThreads writers for one structure.
+// makeTree builds a fresh structure for every run, query/update take it with its synchronization
+template<typename MakeTree, typename QueryFunc, typename UpdateFunc>
+void runReadWriteRows(const string& name, const vector<int>& arr, int opsPerThread, int maxThreads, int durationMs,
+    MakeTree makeTree, QueryFunc query, UpdateFunc update) {
+    int n = arr.size();
+    cout << "\n" << name << "\n";
+    cout << left << setw(9) << "Readers" << setw(9) << "Writers"
+        << setw(11) << "Mops/s" << setw(11) << "Read/s(M)" << setw(12) << "Write/s(M)"
+        << setw(10) << "Read p50" << setw(10) << "Read p99" << setw(13) << "Read p99 max"
+        << setw(11) << "Write p50" << setw(11) << "Write p99" << setw(14) << "Write p99 max" << endl;
+    cout << string(121, '-') << endl;
+
+    // every writer owns at least one index
+    vector<pair<int, double>> readCurve, writeCurve;
+    for (int writers = 1; writers <= min(maxThreads, n); writers *= 2) {
+        for (int readers = 1; readers <= maxThreads; readers *= 2) {
+            vector<vector<pair<int, int>>> readerOps(readers), writerOps(writers);
+            for (auto& ops : readerOps) {
+                ops.resize(opsPerThread);
+                for (auto& op : ops) {
+                    int l = randomInt(0, n - 1), r = randomInt(0, n - 1);
+                    op = { min(l, r), max(l, r) };
+                }
+            }
+            // writer w only sets the indices w, w + writers, w + 2 * writers, ... so the final array is known
+            for (int w = 0; w < writers; w++) {
+                writerOps[w].resize(opsPerThread);
+                int slots = (n - w + writers - 1) / writers;
+                for (auto& op : writerOps[w]) {
+                    op = { w + writers * randomInt(0, slots - 1), randomInt(0, 1000) };
+                }
+            }
+
+            auto tree = makeTree(arr);
+            ReadWriteRun run = runReadersWriters(readerOps, writerOps, durationMs,
+                [&](int l, int r) { return query(*tree, l, r); },
+                [&](int idx, int val) { update(*tree, idx, val); });
+
+            // replay every writer's sets in order to get the final array
+            vector<int> expected(arr);
+            for (int w = 0; w < writers; w++) {
+                const auto& ops = writerOps[w];
+                for (ll i = 0; i < run.writerOps[w]; i++) {
+                    expected[ops[i % ops.size()].first] = ops[i % ops.size()].second;
+                }
+            }
+            ll expectedSum = 0;
+            for (int x : expected) {
+                expectedSum += x;
+            }
+            if (query(*tree, 0, n - 1) != (int)expectedSum) {
+                cerr << name << ": wrong sum after " << readers << " readers / " << writers << " writers" << endl;
+            }
+
+            ll reads = 0, writes = 0;
+            for (ll c : run.readerOps) reads += c;
+            for (ll c : run.writerOps) writes += c;
+            double mops = (reads + writes) / run.seconds / 1e6;
+            cout << left << setw(9) << readers << setw(9) << writers
+                << setw(11) << fixed << setprecision(2) << mops
+                << setw(11) << reads / run.seconds / 1e6
+                << setw(12) << writes / run.seconds / 1e6
+                << setprecision(0)
+                << setw(10) << latencyPercentile(run.readerLatency, 0.5)
+                << setw(10) << latencyPercentile(run.readerLatency, 0.99)
+                << setw(13) << worstThreadP99(run.readerLatency)
+                << setw(11) << latencyPercentile(run.writerLatency, 0.5)
+                << setw(11) << latencyPercentile(run.writerLatency, 0.99)
+                << setw(14) << worstThreadP99(run.writerLatency) << endl;
+            if (writers == 1) {
+                readCurve.push_back({ readers, mops });
+            }
+            if (readers == 1) {
+                writeCurve.push_back({ writers, mops });
+            }
+        }
+    }
+    cout << "  throughput with 1 writer " << scalingLimit(readCurve) << " readers, "
+        << "with 1 reader " << scalingLimit(writeCurve) << " writers\n";
+}
+
+// Readers and writers at once on one shared structure, each with the best synchronization it has:
+// shared_mutex where queries only read, a mutex for SegmentTree (its queries push lazy values down),
+// the shard locks of ShardedSqrtTree and the atomics of ConcurrentFenwickTree.
+// opsPerThread ops are generated per thread and cycled for RW_RUN_MS per run, latencies are in ns
+const int RW_RUN_MS = 200;
+
+void runReadWriteBenchmark(int n, int opsPerThread, int maxThreads) {
+    cout << "\n======= READER/WRITER BENCHMARK =======\n";
+    cout << "n = " << n << ", 1 to " << maxThreads << " readers x 1 to " << min(maxThreads, n) << " writers, "
+        << RW_RUN_MS << " ms per run, " << thread::hardware_concurrency() << " hardware threads\n";
+    cout << "latencies in ns, \"p99 max\" is the highest p99 of a single thread\n";
+
+    vector<int> arr(n);
+    for (int& x : arr) {
+        x = randomInt(0, 1000);
+    }
+
+    struct LockedSqrt { SqrtTree tree; shared_mutex lock; LockedSqrt(const vector<int>& a) : tree(a) {} };
+    runReadWriteRows("SqrtTree + shared_mutex", arr, opsPerThread, maxThreads, RW_RUN_MS,
+        [](const vector<int>& a) { return make_unique<LockedSqrt>(a); },
+        [](LockedSqrt& t, int l, int r) { shared_lock<shared_mutex> guard(t.lock); return t.tree.query(l, r); },
+        [](LockedSqrt& t, int idx, int val) { unique_lock<shared_mutex> guard(t.lock); t.tree.update(idx, val); });
+
+    runReadWriteRows("ShardedSqrtTree", arr, opsPerThread, maxThreads, RW_RUN_MS,
+        [](const vector<int>& a) { return make_unique<ShardedSqrtTree>(a); },
+        [](ShardedSqrtTree& t, int l, int r) { return t.query(l, r); },
+        [](ShardedSqrtTree& t, int idx, int val) { t.update(idx, val); });
+
+    struct LockedSegment { SegmentTree tree; mutex lock; LockedSegment(const vector<int>& a) : tree(a) {} };
+    runReadWriteRows("SegmentTree + mutex", arr, opsPerThread, maxThreads, RW_RUN_MS,
+        [](const vector<int>& a) { return make_unique<LockedSegment>(a); },
+        [](LockedSegment& t, int l, int r) { lock_guard<mutex> guard(t.lock); return t.tree.query(l, r); },
+        [](LockedSegment& t, int idx, int val) { lock_guard<mutex> guard(t.lock); t.tree.set(idx, val); });
+
+    struct LockedFenwick { FenwickTree tree; shared_mutex lock; LockedFenwick(const vector<int>& a) : tree(a) {} };
+    runReadWriteRows("FenwickTree + shared_mutex", arr, opsPerThread, maxThreads, RW_RUN_MS,
+        [](const vector<int>& a) { return make_unique<LockedFenwick>(a); },
+        [](LockedFenwick& t, int l, int r) { shared_lock<shared_mutex> guard(t.lock); return t.tree.query(l, r); },
+        [](LockedFenwick& t, int idx, int val) { unique_lock<shared_mutex> guard(t.lock); t.tree.set(idx, val); });
+
+    // set() reads the old value with a query that may see half of another writer's add, so the writers
+    // keep the values instead: every index has a single writer, which adds the difference to its last value
+    struct ValuedFenwick { ConcurrentFenwickTree tree; vector<int> values; ValuedFenwick(const vector<int>& a) : tree(a), values(a) {} };
+    runReadWriteRows("ConcurrentFenwickTree", arr, opsPerThread, maxThreads, RW_RUN_MS,
+        [](const vector<int>& a) { return make_unique<ValuedFenwick>(a); },
+        [](ValuedFenwick& t, int l, int r) { return t.tree.query(l, r); },
+        [](ValuedFenwick& t, int idx, int val) { t.tree.update(idx, val - t.values[idx]); t.values[idx] = val; });
+    cout << endl;
+}
+
+// Position of one argmin/argmax structure over the same queries: build time, query time, memory and
+// the sum of the answered positions, so the structures can be checked against each other
+template<typename TreeType>
+void runArgQueryRow(const string& name, const vector<int>& arr, const vector<pair<int, int>>& ranges, ll& checksum) {
+    Timer buildTimer;
+    TreeType tree(arr);
+    ll buildTime = buildTimer.Stop();
+    checksum = 0;
+    Timer queryTimer;
+    for (const auto& [l, r] : ranges) {
+        checksum += tree.query(l, r);
+    }
+    ll queryTime = queryTimer.Stop();
+    cout << left << setw(20) << name
+        << setw(15) << buildTime
+        << setw(18) << fixed << setprecision(4) << (ranges.empty() ? 0.0 : (double)queryTime / ranges.size())
+        << setw(15) << tree.memoryUsage() / 1024 << endl;
+}
+
+// Argmin/argmax benchmark: q random ranges over n random values, ArgSqrtTree against a sparse table
+void runArgQueryBenchmark(int n, int q) {
+    cout << "\n======= ARGMIN/ARGMAX BENCHMARK =======\n";
+    cout << "n = " << n << ", " << q << " random ranges\n";
+    cout << left << setw(20) << "Data Structure"
+        << setw(15) << "Build(us)"
+        << setw(18) << "Avg Query(us)"
+        << setw(15) << "Memory(KB)" << endl;
+    cout << string(68, '-') << endl;
+
+    vector<int> arr(n);
+    for (int& x : arr) {
+        x = randomInt(0, n);
+    }
+    vector<pair<int, int>> ranges(q);
+    for (auto& range : ranges) {
+        int l = randomInt(0, n - 1), r = randomInt(0, n - 1);
+        range = { min(l, r), max(l, r) };
+    }
+
+    ll minSqrt, maxSqrt, minSparse, maxSparse;
+    runArgQueryRow<ArgMinSqrtTree>("ArgMinSqrtTree", arr, ranges, minSqrt);
+    runArgQueryRow<ArgSparseTable<less<int>>>("ArgMinSparseTable", arr, ranges, minSparse);
+    runArgQueryRow<ArgMaxSqrtTree>("ArgMaxSqrtTree", arr, ranges, maxSqrt);
+    runArgQueryRow<ArgSparseTable<greater<int>>>("ArgMaxSparseTable", arr, ranges, maxSparse);
+    if (minSqrt != minSparse || maxSqrt != maxSparse) {
+        cerr << "Argmin/argmax mismatch between ArgSqrtTree and ArgSparseTable" << endl;
+    }
+    cout << endl;
+}
+
+// Time ops random updates and then ops random prefix sums on one Fenwick layout, in ns per op
+template<typename TreeType>
+void runFenwickLayoutRow(const string& name, const vector<int>& arr, const vector<int>& positions, ll& checksum) {
+    Timer buildTimer;
+    TreeType tree(arr);
+    ll buildTime = buildTimer.Stop();
+    Timer updateTimer;
+    for (int idx : positions) {
+        tree.update(idx, 1);
+    }
+    ll updateTime = updateTimer.Stop();
+    checksum = 0;
+    Timer queryTimer;
+    for (int idx : positions) {
+        checksum += tree.getSum(idx);
+    }
+    ll queryTime = queryTimer.Stop();
+    double ops = (double)positions.size();
+    cout << left << setw(20) << name
+        << setw(15) << buildTime
+        << setw(18) << fixed << setprecision(1) << updateTime * 1000.0 / ops
+        << setw(18) << fixed << setprecision(1) << queryTime * 1000.0 / ops
+        << setw(15) << tree.memoryUsage() / 1024 << endl;
+}
+
+// FenwickTree against BlockedFenwickTree for n = 2^minLog, 2^(minLog + 2), ... 2^maxLog, ops random positions each
+void runFenwickLayoutBenchmark(int minLog, int maxLog, int ops) {
+    cout << "\n======= FENWICK LAYOUT BENCHMARK =======\n";
+    cout << ops << " random updates then " << ops << " random prefix sums per size\n";
+    for (int log = minLog; log <= maxLog; log += 2) {
+        int n = 1 << log;
+        cout << "\nn = 2^" << log << "\n";
+        cout << left << setw(20) << "Data Structure"
+            << setw(15) << "Build(us)"
+            << setw(18) << "Update(ns/op)"
+            << setw(18) << "GetSum(ns/op)"
+            << setw(15) << "Memory(KB)" << endl;
+        cout << string(86, '-') << endl;
+
+        vector<int> arr(n);
+        for (int& x : arr) {
+            x = randomInt(0, 1000);
+        }
+        vector<int> positions(ops);
+        for (int& idx : positions) {
+            idx = randomInt(0, n - 1);
+        }
+        ll plain, blocked;
+        runFenwickLayoutRow<FenwickTree>("FenwickTree", arr, positions, plain);
+        runFenwickLayoutRow<BlockedFenwickTree>("BlockedFenwick", arr, positions, blocked);
+        if (plain != blocked) {
+            cerr << "Fenwick layout mismatch at n = 2^" << log << endl;
+        }
+    }
+    cout << endl;
+}
+
+#ifdef HAS_INTERLEAVED_EXECUTOR
+// Throughput of one tree answering ranges directly and with 1, 2, 4, ... maxWidth interleaved queries
+template<typename TreeType>
+void runInterleaveRows(const string& name, const vector<int>& arr, const vector<pair<int, int>>& ranges, int maxWidth) {
+    TreeType tree(arr);
+    vector<ll> expected(ranges.size());
+    Timer directTimer;
+    for (size_t i = 0; i < ranges.size(); i++) {
+        expected[i] = tree.query(ranges[i].first, ranges[i].second);
+    }
+    double directNs = directTimer.Stop() * 1000.0 / ranges.size();
+    cout << left << setw(20) << name << setw(10) << "direct"
+        << setw(15) << fixed << setprecision(2) << 1000.0 / directNs
+        << setw(15) << fixed << setprecision(1) << directNs
+        << setw(10) << fixed << setprecision(2) << 1.0 << endl;
+
+    vector<ll> answers;
+    for (int width = 1; width <= maxWidth; width <<= 1) {
+        Timer timer;
+        runInterleaved(tree, ranges, answers, width);
+        double ns = timer.Stop() * 1000.0 / ranges.size();
+        cout << left << setw(20) << name << setw(10) << width
+            << setw(15) << fixed << setprecision(2) << 1000.0 / ns
+            << setw(15) << fixed << setprecision(1) << ns
+            << setw(10) << fixed << setprecision(2) << directNs / ns << endl;
+        if (answers != expected) {
+            cerr << name << ": interleaved answers differ at width " << width << endl;
+        }
+    }
+}
+
+// q random ranges over n random values, answered by SqrtTree and SegmentTree with growing interleave width
+void runInterleaveBenchmark(int n, int q, int maxWidth) {
+    cout << "\n======= INTERLEAVED QUERY BENCHMARK =======\n";
+    cout << "n = " << n << ", " << q << " random ranges, up to " << maxWidth << " queries in flight\n";
+    cout << left << setw(20) << "Data Structure"
+        << setw(10) << "Width"
+        << setw(15) << "Mqueries/s"
+        << setw(15) << "ns/query"
+        << setw(10) << "Speedup" << endl;
+    cout << string(70, '-') << endl;
+
+    vector<int> arr(n);
+    for (int& x : arr) {
+        x = randomInt(0, 1000);
+    }
+    vector<pair<int, int>> ranges(q);
+    for (auto& range : ranges) {
+        int l = randomInt(0, n - 1), r = randomInt(0, n - 1);
+        range = { min(l, r), max(l, r) };
+    }
+
+    runInterleaveRows<SqrtTree>("SqrtTree", arr, ranges, maxWidth);
+    runInterleaveRows<SegmentTree>("SegmentTree", arr, ranges, maxWidth);
+    cout << endl;
+}
+#endif // HAS_INTERLEAVED_EXECUTOR
+
+// Run the phases of the adaptive benchmark on one engine, time of every phase in ms
+void runAdaptiveRow(const string& name, const vector<int>& arr, const RangeEngineConfig& config,
+    const vector<vector<array<int, 4>>>& phases, vector<ll>& checksums, bool showSwitches) {
+    RangeEngine engine(arr, config);
+    cout << left << setw(20) << name;
+    double total = 0;
+    checksums.assign(phases.size(), 0);
+    for (size_t p = 0; p < phases.size(); p++) {
+        Timer timer;
+        for (const auto& op : phases[p]) {
+            if (op[0] == 0) {
+                checksums[p] += engine.query(op[1], op[2]);
+            }
+            else if (op[0] == 1) {
+                engine.update(op[1], op[3]);
+            }
+            else {
+                engine.addRange(op[1], op[2], op[3]);
+            }
+        }
+        double ms = timer.Stop() / 1000.0;
+        total += ms;
+        cout << setw(13) << fixed << setprecision(1) << ms;
+    }
+    cout << setw(13) << fixed << setprecision(1) << total << backendName(engine.backend()) << endl;
+    if (!showSwitches) {
+        return;
+    }
+    engine.waitForRebuild();
+    cout << "  " << engine.switches().size() << " switches, " << engine.rebuildCount() << " rebuilds ("
+        << engine.discardedCount() << " discarded), " << engine.replayedCount() << " updates replayed\n";
+    for (const EngineSwitch& s : engine.switches()) {
+        cout << "  op " << s.op << " (" << fixed << setprecision(3) << s.seconds << " s): "
+            << backendName(s.from) << " -> " << backendName(s.to)
+            << ", updates " << setprecision(0) << s.updateShare * 100 << "%"
+            << ", mean query len " << s.meanQueryLen << ", mean add len " << s.meanAddLen
+            << ", cost " << s.fromCost << " -> " << s.toCost << " ns/op"
+            << ", " << s.replayed << " replayed\n";
+    }
+}
+
+// Read-heavy, write-heavy, range-add and read-heavy again, q ops per phase over n random values:
+// RangeEngine against the same engine pinned to each backend
+void runAdaptiveBenchmark(int n, int q) {
+    cout << "\n======= ADAPTIVE ENGINE BENCHMARK =======\n";
+    cout << "n = " << n << ", " << q << " ops per phase\n";
+    const char* phaseNames[] = { "Read(ms)", "Write(ms)", "RangeAdd(ms)", "Read(ms)" };
+    // share of point sets and of range adds in each phase, the rest are queries
+    // in the range-add phase the queries and adds cover up to 4096 elements, elsewhere the queries are random ranges
+    const int setPercent[] = { 1, 50, 0, 1 };
+    const int addPercent[] = { 0, 0, 5, 0 };
+
+    vector<int> arr(n);
+    for (int& x : arr) {
+        x = randomInt(0, 1000);
+    }
+    vector<vector<array<int, 4>>> phases(4);
+    for (int p = 0; p < 4; p++) {
+        phases[p].resize(q);
+        for (auto& op : phases[p]) {
+            int kind = randomInt(0, 99);
+            int l = randomInt(0, n - 1), r = randomInt(0, n - 1);
+            if (l > r) swap(l, r);
+            if (addPercent[p] > 0) {
+                r = min(n - 1, l + randomInt(0, 4095));
+            }
+            if (kind < setPercent[p]) {
+                op = { 1, l, l, randomInt(0, 1000) };
+            }
+            else if (kind < setPercent[p] + addPercent[p]) {
+                op = { 2, l, r, randomInt(-5, 5) };
+            }
+            else {
+                op = { 0, l, r, 0 };
+            }
+        }
+    }
+
+    cout << left << setw(20) << "Data Structure";
+    for (const char* name : phaseNames) {
+        cout << setw(13) << name;
+    }
+    cout << setw(13) << "Total(ms)" << "Final" << endl;
+    cout << string(100, '-') << endl;
+
+    vector<ll> expected, checksums;
+    for (int b = 0; b < BACKEND_COUNT; b++) {
+        RangeEngineConfig pinned;
+        pinned.initial = (EngineBackend)b;
+        pinned.margin = 1;
+        runAdaptiveRow(backendName((EngineBackend)b), arr, pinned, phases, b == 0 ? expected : checksums, false);
+        if (b > 0 && checksums != expected) {
+            cerr << backendName((EngineBackend)b) << ": answers differ" << endl;
+        }
+    }
+    runAdaptiveRow("RangeEngine", arr, RangeEngineConfig(), phases, checksums, true);
+    if (checksums != expected) {
+        cerr << "RangeEngine: answers differ" << endl;
+    }
+    cout << endl;
+}
+
+// Time to first query of AsyncSqrtTree against a blocking SqrtTree build, then q ops (1% updates)
+// right after the construction, with the latency of each fallback stage they were served by
+void runAsyncBuildBenchmark(int n, int q) {
+    cout << "\n======= ASYNC BUILD BENCHMARK =======\n";
+    cout << "n = " << n << ", " << q << " ops (1% updates) issued right after the construction\n";
+
+    vector<int> arr(n);
+    for (int& x : arr) {
+        x = randomInt(0, 1000);
+    }
+    vector<array<int, 3>> ops(q);
+    for (auto& op : ops) {
+        bool isUpdate = randomInt(0, 99) == 0;
+        int l = randomInt(0, n - 1), r = randomInt(0, n - 1);
+        op = { isUpdate, min(l, r), isUpdate ? randomInt(0, 1000) : max(l, r) };
+    }
+
+    Timer blockingTimer;
+    SqrtTree reference(arr);
+    reference.query(0, n - 1);
+    ll blockingFirst = blockingTimer.Stop();
+
+    // with room for the index part the tree takes the buffer as is, the constructor copies nothing
+    vector<int> moved;
+    moved.reserve(SqrtTree::storageSize(n));
+    moved.assign(arr.begin(), arr.end());
+    Timer asyncTimer;
+    AsyncSqrtTree tree(move(moved));
+    ll returned = asyncTimer.Stop();
+    tree.query(0, n - 1);
+    ll asyncFirst = asyncTimer.Stop();
+
+    const char* stageNames[] = { "Scan", "PrefixSum", "Layers" };
+    ll stageOps[3] = {}, stageTime[3] = {};
+    ll layersAt = -1;
+    for (const auto& op : ops) {
+        AsyncBuildStage stage = tree.stage();
+        if (stage == LAYER_STAGE && layersAt < 0) {
+            layersAt = asyncTimer.Stop();
+        }
+        auto start = high_resolution_clock::now();
+        if (op[0]) {
+            tree.update(op[1], op[2]);
+            reference.update(op[1], op[2]);
+        }
+        else {
+            tree.query(op[1], op[2]);
+        }
+        stageTime[stage] += duration_cast<nanoseconds>(high_resolution_clock::now() - start).count();
+        stageOps[stage]++;
+    }
+    tree.waitUntilReady();
+    if (layersAt < 0) {
+        layersAt = asyncTimer.Stop();
+    }
+
+    cout << left << setw(36) << "SqrtTree build + first query (us)" << blockingFirst << "\n";
+    cout << left << setw(36) << "AsyncSqrtTree constructor (us)" << returned << " (array moved in)\n";
+    cout << left << setw(36) << "AsyncSqrtTree first query (us)" << asyncFirst << "\n";
+    cout << left << setw(36) << "AsyncSqrtTree layers serving (us)" << layersAt << "\n";
+    cout << left << setw(36) << "Updates replayed on the layers" << tree.replayedCount() << "\n\n";
+    cout << left << setw(20) << "Stage" << setw(15) << "Ops" << setw(15) << "Avg Op(ns)" << endl;
+    cout << string(50, '-') << endl;
+    for (int s = 0; s < 3; s++) {
+        cout << left << setw(20) << stageNames[s] << setw(15) << stageOps[s]
+            << setw(15) << fixed << setprecision(1) << (stageOps[s] ? (double)stageTime[s] / stageOps[s] : 0.0) << endl;
+    }
+
+    for (int i = 0; i < min(q, 1000); i++) {
+        int l = randomInt(0, n - 1), r = randomInt(0, n - 1);
+        if (l > r) swap(l, r);
+        if (tree.query(l, r) != reference.query(l, r)) {
+            cerr << "AsyncSqrtTree answers differ from SqrtTree" << endl;
+            break;
+        }
+    }
+    cout << endl;
+}
+
+// One op of an open-loop replay, type 1 = set(x, y), 0 = query(x, y)
+struct OpenLoopOp {
+    int type, x, y;
+};
+
+// Read a test file for open-loop replay. With trace every op line starts with its timestamp in
+// microseconds ("t type x y", nondecreasing), returned in traceNs relative to the first op
+bool loadOpenLoopWorkload(const string& filename, bool trace, vector<int>& arr, vector<OpenLoopOp>& ops, vector<ll>& traceNs) {
+    ifstream in(filename);
+    if (!in.is_open()) {
+        cerr << "Cannot open file " << filename << endl;
+        return false;
+    }
+    ll n;
+    int q;
+    in >> n >> q;
+    if (!in || n <= 0 || n > INT_MAX || q <= 0) {
+        cerr << "Open-loop replay needs 1 to 2147483647 elements and at least one op" << endl;
+        return false;
+    }
+    arr.resize(n);
+    for (ll i = 0; i < n; i++) {
+        in >> arr[i];
+    }
+    ops.resize(q);
+    traceNs.clear();
+    ll firstUs = 0, lastUs = 0;
+    for (int i = 0; i < q; i++) {
+        if (trace) {
+            ll us;
+            in >> us;
+            if (i == 0) {
+                firstUs = lastUs = us;
+            }
+            if (us < lastUs) {
+                cerr << "Trace timestamps must not decrease (op " << i << ")" << endl;
+                return false;
+            }
+            lastUs = us;
+            traceNs.push_back((us - firstUs) * 1000);
+        }
+        in >> ops[i].type >> ops[i].x >> ops[i].y;
+    }
+    if (!in) {
+        cerr << "Cannot read the ops of " << filename << endl;
+        return false;
+    }
+    return true;
+}
+
+// Latencies and throughput of one offered load
+struct OpenLoopPoint {
+    double offered = 0, achieved = 0;
+    ll ops = 0;
+    double p50 = 0, p90 = 0, p99 = 0, p999 = 0, maxUs = 0;
+};
+
+// Latency counts in log-linear buckets: exact below 64 ns, then 64 buckets per power of two (under 2%
+// error), so a load point needs the same few KB whatever its number of ops
+struct LatencyHistogram {
+    static const int SUB_BITS = 6;
+    static const int SUB = 1 << SUB_BITS;
+    vector<ll> counts = vector<ll>(64 * SUB, 0);
+    ll total = 0, maxNs = 0;
+
+    void add(ll ns) {
+        int bucket = (int)ns;
+        if (ns >= SUB) {
+            int e = 63 - __builtin_clzll(ns);
+            bucket = (e - SUB_BITS + 1) * SUB + (int)((ns >> (e - SUB_BITS)) - SUB);
+        }
+        counts[bucket]++;
+        total++;
+        maxNs = max(maxNs, ns);
+    }
+
+    // middle of the bucket holding the p-th (0..1) latency
+    double percentileNs(double p) const {
+        ll rank = min(total - 1, (ll)(p * total)), seen = 0;
+        for (int bucket = 0; bucket < (int)counts.size(); bucket++) {
+            seen += counts[bucket];
+            if (seen > rank) {
+                if (bucket < SUB) {
+                    return bucket;
+                }
+                int shift = bucket / SUB - 1;
+                return min((double)maxNs, ((ll)(bucket % SUB + SUB) << shift) + (double)((1LL << shift) - 1) / 2);
+            }
+        }
+        return maxNs;
+    }
+};
+
+// Issue op i (cycling over ops) at start + dueNs(i) for i < count, waiting if it is early and right away
+// if it is late. Latency runs from the intended time to the end of the op, so the time an op spends waiting
+// behind a slow one is counted (no coordinated omission), as it would be with real arrivals.
+// The end of an op is the clock of the next one, a late op costs a single clock read. A point that runs
+// past OPEN_LOOP_MAX_MS stops there, its queue is growing anyway
+const int OPEN_LOOP_MAX_MS = 2000;
+
+template<typename TreeType, typename UpdateFunc, typename QueryFunc, typename DueFunc>
+OpenLoopPoint runOpenLoopPoint(TreeType& tree, const vector<OpenLoopOp>& ops, ll count, DueFunc dueNs,
+    UpdateFunc update, QueryFunc query, ll& checksum) {
+    LatencyHistogram latency;
+    auto start = steady_clock::now();
+    auto end = start, deadline = start + milliseconds(OPEN_LOOP_MAX_MS);
+    ll done = 0;
+    for (ll i = 0; i < count && end < deadline; i++, done++) {
+        auto due = start + nanoseconds(dueNs(i));
+        while (end < due) {
+            end = steady_clock::now();
+        }
+        const OpenLoopOp& op = ops[i % ops.size()];
+        if (op.type == 1) {
+            update(tree, op.x, op.y);
+        }
+        else {
+            checksum += query(tree, op.x, op.y);
+        }
+        end = steady_clock::now();
+        latency.add(duration_cast<nanoseconds>(end - due).count());
+    }
+
+    OpenLoopPoint point;
+    point.ops = done;
+    point.offered = count > 1 && dueNs(count - 1) > 0 ? (count - 1) * 1e9 / dueNs(count - 1) : 0;
+    point.achieved = done / max(1e-9, duration<double>(end - start).count());
+    point.p50 = latency.percentileNs(0.5) / 1000;
+    point.p90 = latency.percentileNs(0.9) / 1000;
+    point.p99 = latency.percentileNs(0.99) / 1000;
+    point.p999 = latency.percentileNs(0.999) / 1000;
+    point.maxUs = latency.maxNs / 1000.0;
+    return point;
+}
+
+// Every load point runs OPEN_LOOP_MS of schedule (the ops of the file are cycled at a target rate, a trace
+// is cut there); the load grows by sqrt(2) per point, and a load is saturated when less than 95% of it is
+// served twice in a row, the queue then keeps growing (once may be a stall of the machine)
+const int OPEN_LOOP_MS = 500;
+// highest target rate, --open-loop rejects more and the sweep stops there
+const ll OPEN_LOOP_MAX_RATE = 1000000000;
+const int OPEN_LOOP_MAX_POINTS = 40;
+
+// The latency curve of one structure: its closed-loop rate for reference, then the offered loads up to
+// the first saturated one. A rate of 0 starts at 1/16 of the closed-loop rate, with traceNs the trace
+// is replayed at 1x, 1.4x, 2x, ... its recorded speed and rate is not used
+template<typename TreeType, typename UpdateFunc, typename QueryFunc>
+void runOpenLoopRows(const string& name, const vector<int>& arr, const vector<OpenLoopOp>& ops, const vector<ll>& traceNs,
+    ll rate, UpdateFunc update, QueryFunc query) {
+    ll checksum = 0;
+    {
+        // closed loop over a copy, the replays start from the original values
+        TreeType closed(arr);
+        auto start = steady_clock::now();
+        for (const OpenLoopOp& op : ops) {
+            if (op.type == 1) {
+                update(closed, op.x, op.y);
+            }
+            else {
+                checksum += query(closed, op.x, op.y);
+            }
+        }
+        double closedRate = ops.size() / max(1e-9, duration<double>(steady_clock::now() - start).count());
+        cout << "\n" << name << " (closed loop: " << fixed << setprecision(0) << closedRate << " ops/s)\n";
+        if (traceNs.empty() && rate == 0) {
+            rate = max(1LL, (ll)(closedRate / 16));
+        }
+    }
+    cout << left << setw(14) << "Offered/s" << setw(14) << "Achieved/s" << setw(9) << "Ops"
+        << setw(11) << "p50(us)" << setw(11) << "p90(us)" << setw(11) << "p99(us)"
+        << setw(12) << "p99.9(us)" << setw(12) << "Max(us)" << endl;
+    cout << string(94, '-') << endl;
+
+    TreeType tree(arr);
+    double sustained = 0, saturatedAt = 0;
+    for (int k = 0; k < OPEN_LOOP_MAX_POINTS && saturatedAt == 0; k++) {
+        double speed = pow(2.0, k / 2.0);
+        if (traceNs.empty() && rate * speed > OPEN_LOOP_MAX_RATE) {
+            break;
+        }
+        // due times are computed per op, a point holds no schedule
+        ll count = 0;
+        function<ll(ll)> dueNs;
+        if (traceNs.empty()) {
+            count = max(1LL, (ll)(rate * speed * OPEN_LOOP_MS / 1000));
+            dueNs = [&](ll i) { return (ll)(i * 1e9 / (rate * speed)); };
+        }
+        else {
+            count = upper_bound(traceNs.begin(), traceNs.end(), (ll)(speed * OPEN_LOOP_MS * 1e6) - 1) - traceNs.begin();
+            count = max(1LL, count);
+            dueNs = [&](ll i) { return (ll)(traceNs[i] / speed); };
+        }
+        OpenLoopPoint point = runOpenLoopPoint(tree, ops, count, dueNs, update, query, checksum);
+        if (point.achieved < 0.95 * point.offered) {
+            point = runOpenLoopPoint(tree, ops, count, dueNs, update, query, checksum);
+        }
+        cout << left << setw(14) << fixed << setprecision(0) << point.offered << setw(14) << point.achieved
+            << setw(9) << point.ops << setprecision(2)
+            << setw(11) << point.p50 << setw(11) << point.p90 << setw(11) << point.p99
+            << setw(12) << point.p999 << setw(12) << point.maxUs << endl;
+        // every op at the same time, there is no rate to raise
+        if (point.offered == 0) {
+            break;
+        }
+        if (point.achieved < 0.95 * point.offered) {
+            saturatedAt = point.offered;
+        }
+        else {
+            sustained = max(sustained, point.offered);
+        }
+    }
+    cout << setprecision(0) << "  sustains " << sustained << " ops/s";
+    if (saturatedAt > 0) {
+        cout << ", saturated at " << saturatedAt << " ops/s";
+    }
+    else {
+        cout << ", not saturated";
+    }
+    cout << " (checksum " << checksum << ")\n";
+}
+
+// Open-loop replay of a test file: the ops are issued on a schedule instead of back to back, at a target
+// rate (0 = 1/16 of each structure's closed-loop rate) or at the timestamps of a trace, and the load is
+// raised until the structure falls behind. Latencies include the queueing behind earlier ops
+void runOpenLoopBenchmark(const string& filename, ll rate, bool trace) {
+    vector<int> arr;
+    vector<OpenLoopOp> ops;
+    vector<ll> traceNs;
+    if (!loadOpenLoopWorkload(filename, trace, arr, ops, traceNs)) {
+        return;
+    }
+
+    cout << "\n======= OPEN-LOOP BENCHMARK =======\n";
+    cout << "file " << filename << ", n = " << arr.size() << ", " << ops.size() << " ops, ";
+    if (trace) {
+        cout << "trace of " << fixed << setprecision(3) << (traceNs.empty() ? 0.0 : traceNs.back() / 1e9)
+            << " s replayed at 1x, 1.4x, 2x, ... speed";
+    }
+    else if (rate > 0) {
+        cout << "from " << rate << " ops/s, x1.4 per load";
+    }
+    else {
+        cout << "from 1/16 of the closed-loop rate, x1.4 per load";
+    }
+    cout << ", up to " << OPEN_LOOP_MS << " ms of schedule per load\n";
+    cout << "latency from the intended start of every op, saturated = under 95% of the offered load served\n";
+
+    runOpenLoopRows<SqrtTree>("SqrtTree", arr, ops, traceNs, rate,
+        [](SqrtTree& tree, int idx, int val) { tree.update(idx, val); },
+        [](SqrtTree& tree, int l, int r) { return tree.query(l, r); });
+    runOpenLoopRows<SegmentTree>("SegmentTree", arr, ops, traceNs, rate,
+        [](SegmentTree& tree, int idx, int val) { tree.set(idx, val); },
+        [](SegmentTree& tree, int l, int r) { return tree.query(l, r); });
+    runOpenLoopRows<WideSegmentTree>("WideSegTree", arr, ops, traceNs, rate,
+        [](WideSegmentTree& tree, int idx, int val) { tree.set(idx, val); },
+        [](WideSegmentTree& tree, int l, int r) { return tree.query(l, r); });
+    runOpenLoopRows<FenwickTree>("FenwickTree", arr, ops, traceNs, rate,
+        [](FenwickTree& tree, int idx, int val) { tree.set(idx, val); },
+        [](FenwickTree& tree, int l, int r) { return tree.query(l, r); });
+    runOpenLoopRows<BlockedFenwickTree>("BlockedFenwick", arr, ops, traceNs, rate,
+        [](BlockedFenwickTree& tree, int idx, int val) { tree.set(idx, val); },
+        [](BlockedFenwickTree& tree, int l, int r) { return tree.query(l, r); });
+    // its background rebuilds show up as latency spikes here
+    runOpenLoopRows<RangeEngine>("RangeEngine", arr, ops, traceNs, rate,
+        [](RangeEngine& tree, int idx, int val) { tree.update(idx, val); },
+        [](RangeEngine& tree, int l, int r) { return tree.query(l, r); });
+    cout << endl;
+}
+
 // Run the entire experiment
-void runExperiment(const string& filename, const TestConfig& config) {
+void runExperiment(const string& filename, const TestConfig& config, bool hugePages = false) {
     // Generate test case
     generateTest(filename, config);
 
     // Run benchmarks
-    vector<BenchmarkResult> results = runAllBenchmarks(filename);
+    vector<BenchmarkResult> results = runAllBenchmarks(filename, hugePages);
 
     // Print results
     printBenchmarkResults(results);
@@ -393,10 +1721,10 @@ void runExperiment(const string& filename, const TestConfig& config) {
 }
 
 TestConfig create_custom_config(
-    int n, int q, double updateRatio, int minVal, int maxVal,
-    ArrayPattern arrPat, RangePattern rangePat, int fixLength = 0
+    ll n, int q, double updateRatio, int minVal, int maxVal,
+    ArrayPattern arrPat, RangePattern rangePat, int fixLength = 0, unsigned long long seed = 0
 ) {
-    TestConfig config{ n, q, updateRatio, minVal, maxVal, arrPat, rangePat, fixLength };
+    TestConfig config{ n, q, updateRatio, minVal, maxVal, arrPat, rangePat, fixLength, seed };
     return config;
 }
 #endif // !benchmark_h
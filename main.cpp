@@ -2,9 +2,12 @@
 #include "FenwickTree.h"
 #include "BasicLibraries.h"
 #include "benchmark.h"
+#include "QueryServer.h"
 
 const std::vector<std::string> dataTypes = { "Random", "Ascending", "Descending", "Constant" };
-const std::vector<std::string> rangeTypes = { "Random_Range", "Small_Ranges", "Large_Ranges", "Fixed_Length" };
+const std::vector<std::string> rangeTypes = { "Random_Range", "Small_Ranges", "Large_Ranges", "Fixed_Length",
+    "Zipf_Ranges", "Hotspot_Ranges", "Sequential_Ranges", "Burst_Ranges" };
+const std::vector<std::string> updateTypes = { "Uniform", "Zipf", "Hotspot", "Sequential", "Burst" };
 
 bool isNumber(const std::string& s) {
     if (s.empty()) return false;
@@ -37,9 +40,21 @@ RangePattern stringToRangePattern(const std::string& str) {
     if (str == "Small_Ranges") return SMALL_RANGES;
     if (str == "Large_Ranges") return LARGE_RANGES;
     if (str == "Fixed_Length") return FIXED_LENGTH;
+    if (str == "Zipf_Ranges") return ZIPF_RANGES;
+    if (str == "Hotspot_Ranges") return HOTSPOT_RANGES;
+    if (str == "Sequential_Ranges") return SEQUENTIAL_RANGES;
+    if (str == "Burst_Ranges") return BURST_RANGES;
     return RANDOM_RANGE; // Gia tri mac dinh
 }
 
+AccessPattern stringToAccessPattern(const std::string& str) {
+    if (str == "Zipf") return ZIPF_ACCESS;
+    if (str == "Hotspot") return HOTSPOT_ACCESS;
+    if (str == "Sequential") return SEQUENTIAL_ACCESS;
+    if (str == "Burst") return BURST_ACCESS;
+    return UNIFORM_ACCESS; // Gia tri mac dinh
+}
+
 void showHelp() {
     std::cout << "Data Structure Benchmark Tool\n"
         << "=============================\n\n"
@@ -55,6 +70,38 @@ void showHelp() {
         << "  --min <val>             Minimum value in array\n"
         << "  --max <val>             Maximum value in array\n"
         << "  --fixed-len <len>       Fixed length for ranges\n"
+        << "  --seed <num>            Seed of the generator, the same seed gives the same test file\n"
+        << "  --hugepages             Also benchmark the trees with their arrays on transparent huge pages\n"
+        << "  --hugetlb               Like --hugepages but with reserved MAP_HUGETLB pages (falls back if none)\n"
+        << "  --update-pattern <type> Update index pattern\n"
+        << "  --zipf-s <exp>          Zipf exponent for Zipf patterns (default 0.99)\n"
+        << "  --hot-fraction <f>      Hot region size relative to n for Hotspot patterns (default 0.01)\n"
+        << "  --hot-prob <p>          Probability of hitting the hot region (default 0.9)\n"
+        << "  --sweep-step <num>      Distance between consecutive ops for Sequential patterns (default 1)\n"
+        << "  --burst-len <num>       Ops per burst for Burst patterns (default 64)\n"
+        << "  --burst-width <num>     Block width of a burst (default sqrt(n))\n"
+        << "  --concurrent-fenwick <threads>\n"
+        << "                          Benchmark concurrent FenwickTree ingestion with 1 to <threads> writers\n"
+        << "                          (-n counters, -q increments per writer)\n"
+        << "  --arg-rmq               Benchmark argmin/argmax positions of -q random ranges over -n values,\n"
+        << "                          ArgSqrtTree against a sparse table\n"
+        << "  --fenwick-layout <log>  Benchmark FenwickTree against BlockedFenwickTree for n = 2^20 ... 2^<log>\n"
+        << "                          (-q random updates and prefix sums per size)\n"
+        << "  --adaptive              Benchmark RangeEngine against each fixed backend over read-heavy, write-heavy\n"
+        << "                          and range-add phases of -q ops on -n values, with its switch log\n"
+        << "  --async-build           Benchmark the time to first query of AsyncSqrtTree against a blocking\n"
+        << "                          SqrtTree build on -n values, then -q ops served during its build\n"
+        << "  --rw-threads <max>      Benchmark 1 to <max> reader threads against 1 to <max> writer threads on one\n"
+        << "                          shared structure of -n values (0 = hardware threads), -q ops per thread\n"
+        << "  --interleave <width>    Benchmark -q random range queries over -n values with 1, 2, 4, ... <width>\n"
+        << "                          coroutine-interleaved queries in flight (needs a -std=c++20 build)\n"
+        << "  --open-loop <ops/s>     Replay the ops of the test file at a fixed rate instead of back to back,\n"
+        << "                          raised until each structure falls behind (0 = from 1/16 of its closed-loop rate)\n"
+        << "  --trace                 Open-loop replay at the timestamps of a trace (-i file with \"t type x y\" op\n"
+        << "                          lines, t in microseconds), sped up until each structure falls behind\n"
+        << "  --serve                 Serve operations from stdin, answers go to stdout\n"
+        << "  --socket <path>         With --serve: listen on a Unix-domain socket instead of stdin\n"
+        << "  --client <path>         Send the -i test file to a server on <path>, print the answers\n"
         << "Data Pattern Types:\n"
         << "  Random                  Random values\n"
         << "  Ascending               Ascending sorted values\n"
@@ -64,14 +111,28 @@ void showHelp() {
         << "  Random_Range            Random query ranges\n"
         << "  Small_Ranges            Small query ranges (≤ n/20)\n"
         << "  Large_Ranges            Large query ranges (≥ n/2)\n"
-        << "  Fixed_Length            Fixed-length query ranges\n\n"
+        << "  Fixed_Length            Fixed-length query ranges\n"
+        << "  Zipf_Ranges             Small ranges starting at Zipf-distributed positions\n"
+        << "  Hotspot_Ranges          Small ranges starting mostly inside a hot region\n"
+        << "  Sequential_Ranges       Small ranges sweeping the array left to right\n"
+        << "  Burst_Ranges            Small ranges, each burst of ops inside one block\n\n"
+        << "Update Pattern Types:\n"
+        << "  Uniform                 Uniformly random indices (default)\n"
+        << "  Zipf                    Zipf-distributed hot keys\n"
+        << "  Hotspot                 Most updates inside a hot region\n"
+        << "  Sequential              Indices sweeping the array left to right\n"
+        << "  Burst                   Bursts of updates clustered in one block\n\n"
         << "Examples:\n"
         << "  ./benchmark -n 100000 -q 100000 -u 0.5 -t Random -r Large_Ranges --min 0 --max 100000\n";
 }
 
-void parseArgs(int argc, char* argv[], std::string& inputFile, int& n, int& numQueries,
+void parseArgs(int argc, char* argv[], std::string& inputFile, long long& n, int& numQueries,
     double& updateRatio, std::string& dataType,
-    std::string& rangeType, int& minVal, int& maxVal, int& fixedLength) {
+    std::string& rangeType, int& minVal, int& maxVal, int& fixedLength, int& concurrentThreads,
+    bool& serve, std::string& socketPath, std::string& clientSocket,
+    unsigned long long& seed, bool& hasSeed, TestConfig& accessConfig, bool& hugePages, bool& argBench, int& fenwickLayoutLog,
+    int& interleaveWidth, bool& adaptiveBench, bool& asyncBench, int& rwThreads,
+    ll& openLoopRate, bool& trace) {
     for (int i = 1; i < argc; i++) {
         std::string arg = argv[i];
 
@@ -87,7 +148,7 @@ void parseArgs(int argc, char* argv[], std::string& inputFile, int& n, int& numQ
         // Tham so so luong phan tu mang
         else if (arg == "-n" && i + 1 < argc) {
             if (isNumber(argv[i + 1])) {
-                n = std::stoi(argv[++i]);
+                n = std::stoll(argv[++i]);
                 if (n <= 0) {
                     std::cerr << "Error: Number of keys must be positive\n";
                     exit(1);
@@ -182,6 +243,171 @@ void parseArgs(int argc, char* argv[], std::string& inputFile, int& n, int& numQ
                 exit(1);
             }
         }
+        // Seed cua bo sinh so ngau nhien
+        else if (arg == "--seed" && i + 1 < argc) {
+            if (isNumber(argv[i + 1])) {
+                seed = std::stoull(argv[++i]);
+                hasSeed = true;
+            }
+            else {
+                std::cerr << "Error: Invalid number for --seed option\n";
+                exit(1);
+            }
+        }
+        // Chay them cac cay tren huge page
+        else if (arg == "--hugepages") {
+            hugePages = true;
+        }
+        else if (arg == "--hugetlb") {
+            hugePages = true;
+            HugePageArena::preferHugeTlb() = true;
+        }
+        // Mau truy cap cua cac thao tac cap nhat
+        else if (arg == "--update-pattern" && i + 1 < argc) {
+            std::string type = argv[++i];
+            if (std::find(updateTypes.begin(), updateTypes.end(), type) != updateTypes.end()) {
+                accessConfig.updatePat = stringToAccessPattern(type);
+            }
+            else {
+                std::cerr << "Error: Invalid update pattern. Use -h for available types\n";
+                exit(1);
+            }
+        }
+        // Tham so cua cac mau truy cap
+        else if (arg == "--zipf-s" && i + 1 < argc) {
+            if (isDouble(argv[i + 1]) && std::stod(argv[i + 1]) > 0.0) {
+                accessConfig.zipfS = std::stod(argv[++i]);
+            }
+            else {
+                std::cerr << "Error: Zipf exponent must be a positive number\n";
+                exit(1);
+            }
+        }
+        else if (arg == "--hot-fraction" && i + 1 < argc) {
+            if (isDouble(argv[i + 1]) && std::stod(argv[i + 1]) > 0.0 && std::stod(argv[i + 1]) <= 1.0) {
+                accessConfig.hotFraction = std::stod(argv[++i]);
+            }
+            else {
+                std::cerr << "Error: Hot fraction must be in (0.0, 1.0]\n";
+                exit(1);
+            }
+        }
+        else if (arg == "--hot-prob" && i + 1 < argc) {
+            if (isDouble(argv[i + 1]) && std::stod(argv[i + 1]) >= 0.0 && std::stod(argv[i + 1]) <= 1.0) {
+                accessConfig.hotProb = std::stod(argv[++i]);
+            }
+            else {
+                std::cerr << "Error: Hot probability must be between 0.0 and 1.0\n";
+                exit(1);
+            }
+        }
+        else if (arg == "--sweep-step" && i + 1 < argc) {
+            if (isNumber(argv[i + 1]) && std::stoi(argv[i + 1]) > 0) {
+                accessConfig.sweepStep = std::stoi(argv[++i]);
+            }
+            else {
+                std::cerr << "Error: Sweep step must be positive\n";
+                exit(1);
+            }
+        }
+        else if (arg == "--burst-len" && i + 1 < argc) {
+            if (isNumber(argv[i + 1]) && std::stoi(argv[i + 1]) > 0) {
+                accessConfig.burstLen = std::stoi(argv[++i]);
+            }
+            else {
+                std::cerr << "Error: Burst length must be positive\n";
+                exit(1);
+            }
+        }
+        else if (arg == "--burst-width" && i + 1 < argc) {
+            if (isNumber(argv[i + 1]) && std::stoi(argv[i + 1]) > 0) {
+                accessConfig.burstWidth = std::stoi(argv[++i]);
+            }
+            else {
+                std::cerr << "Error: Burst width must be positive\n";
+                exit(1);
+            }
+        }
+        // So luong luong ghi toi da cho benchmark FenwickTree dong thoi
+        else if (arg == "--concurrent-fenwick" && i + 1 < argc) {
+            if (isNumber(argv[i + 1])) {
+                concurrentThreads = std::stoi(argv[++i]);
+                if (concurrentThreads <= 0) {
+                    std::cerr << "Error: Number of writer threads must be positive\n";
+                    exit(1);
+                }
+            }
+            else {
+                std::cerr << "Error: Invalid number for --concurrent-fenwick option\n";
+                exit(1);
+            }
+        }
+        // Benchmark vi tri min/max cua doan
+        else if (arg == "--arg-rmq") {
+            argBench = true;
+        }
+        // Benchmark cach bo tri FenwickTree, n tu 2^20 den 2^<log>
+        else if (arg == "--fenwick-layout" && i + 1 < argc) {
+            if (isNumber(argv[i + 1]) && std::stoi(argv[i + 1]) >= 20 && std::stoi(argv[i + 1]) <= 30) {
+                fenwickLayoutLog = std::stoi(argv[++i]);
+            }
+            else {
+                std::cerr << "Error: --fenwick-layout needs a log size between 20 and 30\n";
+                exit(1);
+            }
+        }
+        // Benchmark RangeEngine tu doi cau truc theo tung pha
+        else if (arg == "--adaptive") {
+            adaptiveBench = true;
+        }
+        // Benchmark thoi gian toi truy van dau tien khi build SqrtTree o nen
+        else if (arg == "--async-build") {
+            asyncBench = true;
+        }
+        // Benchmark doc/ghi dong thoi, toi da <max> luong doc va <max> luong ghi
+        else if (arg == "--rw-threads" && i + 1 < argc) {
+            if (isNumber(argv[i + 1]) && std::stoi(argv[i + 1]) >= 0 && std::stoi(argv[i + 1]) <= 256) {
+                rwThreads = std::stoi(argv[++i]);
+            }
+            else {
+                std::cerr << "Error: --rw-threads needs a thread count between 0 and 256\n";
+                exit(1);
+            }
+        }
+        // Phat lai thao tac theo lich voi toc do cho truoc (open loop)
+        else if (arg == "--open-loop" && i + 1 < argc) {
+            if (isNumber(argv[i + 1]) && strlen(argv[i + 1]) <= 10 && std::stoll(argv[i + 1]) <= OPEN_LOOP_MAX_RATE) {
+                openLoopRate = std::stoll(argv[++i]);
+            }
+            else {
+                std::cerr << "Error: --open-loop needs a rate in ops/s, at most " << OPEN_LOOP_MAX_RATE << " (0 = automatic)\n";
+                exit(1);
+            }
+        }
+        // Phat lai theo thoi diem ghi trong file trace
+        else if (arg == "--trace") {
+            trace = true;
+        }
+        // Benchmark truy van xen ke bang coroutine, toi da <width> truy van cung luc
+        else if (arg == "--interleave" && i + 1 < argc) {
+            if (isNumber(argv[i + 1]) && std::stoi(argv[i + 1]) >= 1 && std::stoi(argv[i + 1]) <= 1024) {
+                interleaveWidth = std::stoi(argv[++i]);
+            }
+            else {
+                std::cerr << "Error: --interleave needs a width between 1 and 1024\n";
+                exit(1);
+            }
+        }
+        // Che do server doc thao tac tu stdin hoac socket
+        else if (arg == "--serve") {
+            serve = true;
+        }
+        else if (arg == "--socket" && i + 1 < argc) {
+            socketPath = argv[++i];
+        }
+        else if (arg == "--client" && i + 1 < argc) {
+            clientSocket = argv[++i];
+        }
         else {
             // Thu phan tich nhu tham so vi tri (tuong thich nguoc)
             if (isNumber(arg)) {
@@ -214,20 +440,152 @@ void parseArgs(int argc, char* argv[], std::string& inputFile, int& n, int& numQ
 
 void processArgs(int argc, char* argv[]) {
     std::string inputFile, dataType, rangeType;
-    int n = 0, minVal, maxVal, fixedLength, numQueries;
-    double updateRatio;
+    std::string socketPath, clientSocket;
+    long long n = 0;
+    int minVal = 0, maxVal = 1000000, fixedLength = 0, numQueries = 0;
+    double updateRatio = 0.0;
+    int concurrentThreads = 0;
+    bool serve = false;
+    unsigned long long seed = 0;
+    bool hasSeed = false;
+    // Chi dung cac truong mau truy cap (updatePat, zipfS, ...)
+    TestConfig accessConfig{};
+    bool hugePages = false;
+    bool argBench = false;
+    int fenwickLayoutLog = 0;
+    int interleaveWidth = 0;
+    bool adaptiveBench = false;
+    bool asyncBench = false;
+    int rwThreads = -1;
+    ll openLoopRate = -1;
+    bool trace = false;
 
     if (argc <= 1) {
         showHelp();
         return;
     }
 
-    parseArgs(argc, argv, inputFile, n, numQueries, updateRatio, dataType, rangeType, minVal, maxVal, fixedLength);
+    parseArgs(argc, argv, inputFile, n, numQueries, updateRatio, dataType, rangeType, minVal, maxVal, fixedLength, concurrentThreads,
+        serve, socketPath, clientSocket, seed, hasSeed, accessConfig, hugePages, argBench, fenwickLayoutLog,
+        interleaveWidth, adaptiveBench, asyncBench, rwThreads,
+        openLoopRate, trace);
+
+    // Khong co seed thi lay ngau nhien, seed duoc in ra de chay lai duoc
+    if (!hasSeed) {
+        std::random_device rd;
+        seed = ((unsigned long long)rd() << 32) | rd();
+    }
+    seedRandom(seed);
+
+    // Che do server / client, khong tao file test
+    if (serve || !clientSocket.empty()) {
+#ifndef _WIN32
+        if (serve) {
+            runServer(socketPath);
+        }
+        else if (inputFile.empty()) {
+            std::cerr << "Error: --client needs a test file (-i)\n";
+        }
+        else {
+            runClient(clientSocket, inputFile);
+        }
+#else
+        std::cerr << "Error: --serve and --client are not supported on this platform\n";
+#endif
+        return;
+    }
+
+    // Benchmark FenwickTree dong thoi, khong can file test
+    if (concurrentThreads > 0) {
+        if (n <= 0 || numQueries <= 0 || n > INT_MAX) {
+            std::cerr << "Error: --concurrent-fenwick needs -n (at most 2147483647) and -q\n";
+            exit(1);
+        }
+        runConcurrentFenwickBenchmark(n, numQueries, concurrentThreads);
+        return;
+    }
+
+    // Benchmark argmin/argmax, khong can file test
+    if (argBench) {
+        if (n <= 0 || numQueries <= 0 || n > INT_MAX) {
+            std::cerr << "Error: --arg-rmq needs -n (at most 2147483647) and -q\n";
+            exit(1);
+        }
+        runArgQueryBenchmark(n, numQueries);
+        return;
+    }
+
+    // Benchmark cach bo tri FenwickTree, khong can file test
+    if (fenwickLayoutLog > 0) {
+        if (numQueries <= 0) {
+            std::cerr << "Error: --fenwick-layout needs -q\n";
+            exit(1);
+        }
+        runFenwickLayoutBenchmark(20, fenwickLayoutLog, numQueries);
+        return;
+    }
+
+    // Benchmark RangeEngine theo pha, khong can file test
+    if (adaptiveBench) {
+        if (n <= 0 || numQueries <= 0 || n > INT_MAX) {
+            std::cerr << "Error: --adaptive needs -n (at most 2147483647) and -q\n";
+            exit(1);
+        }
+        runAdaptiveBenchmark(n, numQueries);
+        return;
+    }
+
+    // Benchmark build SqrtTree o nen, khong can file test
+    if (asyncBench) {
+        if (n <= 0 || numQueries <= 0 || n > INT_MAX) {
+            std::cerr << "Error: --async-build needs -n (at most 2147483647) and -q\n";
+            exit(1);
+        }
+        runAsyncBuildBenchmark(n, numQueries);
+        return;
+    }
+
+    // Benchmark doc/ghi dong thoi, 0 luong la so luong phan cung
+    if (rwThreads >= 0) {
+        if (n <= 0 || numQueries <= 0 || n > INT_MAX) {
+            std::cerr << "Error: --rw-threads needs -n (at most 2147483647) and -q\n";
+            exit(1);
+        }
+        if (rwThreads == 0) {
+            rwThreads = max(1u, std::thread::hardware_concurrency());
+        }
+        runReadWriteBenchmark(n, numQueries, rwThreads);
+        return;
+    }
+
+    // Benchmark truy van xen ke, khong can file test
+    if (interleaveWidth > 0) {
+#ifdef HAS_INTERLEAVED_EXECUTOR
+        if (n <= 0 || numQueries <= 0 || n > INT_MAX) {
+            std::cerr << "Error: --interleave needs -n (at most 2147483647) and -q\n";
+            exit(1);
+        }
+        runInterleaveBenchmark(n, numQueries, interleaveWidth);
+#else
+        std::cerr << "Error: --interleave needs a build with C++20 coroutines (-std=c++20)\n";
+#endif
+        return;
+    }
+
+    // Phat lai open loop, file trace phai co san
+    bool openLoop = openLoopRate >= 0 || trace;
+    if (trace && inputFile.empty()) {
+        std::cerr << "Error: --trace needs a trace file (-i)\n";
+        exit(1);
+    }
 
     // Neu co file input, chi chay benchmark khong tao file moi/
-    if (!inputFile.empty()) {
+    if (!inputFile.empty() && openLoop) {
+        runOpenLoopBenchmark(inputFile, max(0LL, openLoopRate), trace);
+    }
+    else if (!inputFile.empty()) {
         cout << "Sử dụng file input có sẵn: " << inputFile << endl;
-        vector<BenchmarkResult> results = runAllBenchmarks(inputFile);
+        vector<BenchmarkResult> results = runAllBenchmarks(inputFile, hugePages);
         printBenchmarkResults(results);
 
         // Luu ket qua ra file CSV
@@ -238,11 +596,24 @@ void processArgs(int argc, char* argv[]) {
         // Tao file moi voi config
         ArrayPattern arrPat = stringToArrayPattern(dataType);
         RangePattern rangePat = stringToRangePattern(rangeType);
-        TestConfig config = create_custom_config(n, numQueries, updateRatio, minVal, maxVal, arrPat, rangePat, fixedLength);
+        TestConfig config = create_custom_config(n, numQueries, updateRatio, minVal, maxVal, arrPat, rangePat, fixedLength, seed);
+        config.updatePat = accessConfig.updatePat;
+        config.zipfS = accessConfig.zipfS;
+        config.hotFraction = accessConfig.hotFraction;
+        config.hotProb = accessConfig.hotProb;
+        config.sweepStep = accessConfig.sweepStep;
+        config.burstLen = accessConfig.burstLen;
+        config.burstWidth = accessConfig.burstWidth;
 
         // Tao ten file mac đinh
         string defaultFilename = "test_" + to_string(n) + "_" + to_string(numQueries) + ".txt";
-        runExperiment(defaultFilename, config);
+        if (openLoop) {
+            generateTest(defaultFilename, config);
+            runOpenLoopBenchmark(defaultFilename, openLoopRate, false);
+        }
+        else {
+            runExperiment(defaultFilename, config, hugePages);
+        }
     }
 }
 